@@ -3,11 +3,39 @@
 
 PROCESS_COUNTS=(1 2 4 8 16 20)
 ITERATIONS=3
-INPUT_FILE="/homes/dan/625/wiki_dump.txt"
+INPUT_FILE="${INPUT_FILE:-/homes/dan/625/wiki_dump.txt}"  # Or a tools/gen_corpus file
 OUTPUT_DIR="performance_data"
 
+# Every run also writes per-phase wall times (read, partition, compute,
+# gather, output) as JSON; COUNTERS=1 adds hardware counters to them
+TIMING_FLAGS=""
+if [ "${COUNTERS:-0}" = "1" ]; then
+    TIMING_FLAGS="-c"
+fi
+
+# MODE=hybrid runs SOCKETS ranks (one per socket, or one per node with
+# HOSTFILE set) and the rest of each core count as worker threads in each
+# rank, instead of one single-threaded rank per core
+MODE=${MODE:-flat}
+SOCKETS=${SOCKETS:-2}
+HOSTFILE=${HOSTFILE:-}
+if [ "$MODE" = "hybrid" ]; then
+    OUTPUT_DIR="performance_data_hybrid"
+fi
+
 mkdir -p $OUTPUT_DIR
 
+# Every implementation is measured through the same maxascii driver, built
+# once with all backends, so runs differ only in the backend they pick
+DRIVER=../common/maxascii
+make -C ../common clean
+make -C ../common MPI=1
+
+# Bandwidth ceilings for analyze_results.py: memory read bandwidth at each
+# count tested below, and storage / page-cache read bandwidth of the input
+make -C ../tools bw_probe
+../tools/bw_probe -t $(IFS=,; echo "${PROCESS_COUNTS[*]}") -f $INPUT_FILE -j $OUTPUT_DIR/bandwidth.json
+
 run_tests() {
     proc_count=$1
     echo "Testing with $proc_count processes..."
@@ -15,16 +43,27 @@ run_tests() {
     proc_dir="$OUTPUT_DIR/procs_$proc_count"
     mkdir -p $proc_dir
 
-    make clean
-    make
+    if [ "$MODE" = "hybrid" ]; then
+        ranks=$(( proc_count < SOCKETS ? proc_count : SOCKETS ))
+        threads=$(( proc_count / ranks ))
+        if [ -n "$HOSTFILE" ]; then
+            launch="mpirun --hostfile $HOSTFILE --map-by ppr:1:node --bind-to none -np $ranks"
+        else
+            launch="mpirun --map-by ppr:1:socket --bind-to socket -np $ranks"
+        fi
+    else
+        threads=1
+        launch="mpirun --oversubscribe -np $proc_count"
+    fi
 
     for i in $(seq 1 $ITERATIONS); do
         echo "  Iteration $i of $ITERATIONS"
 
         output_file="$proc_dir/output_$i.txt"
         stats_file="$proc_dir/stats_$i.txt"
+        phases_file="$proc_dir/phases_$i.json"
 
-        /usr/bin/time -v mpirun --oversubscribe -np $proc_count ./mpi_max_ascii $INPUT_FILE > $output_file 2> $stats_file
+        /usr/bin/time -v $launch $DRIVER -b mpi -t $threads $TIMING_FLAGS -j $phases_file $INPUT_FILE > $output_file 2> $stats_file
 
         echo "Process count: $proc_count, Iteration: $i" >> "$proc_dir/summary.txt"
         grep "User time" $stats_file >> "$proc_dir/summary.txt"
@@ -57,4 +96,17 @@ for pc in "${PROCESS_COUNTS[@]}"; do
     done
 done
 
+# Collect the per-run phase timings into one JSON array next to summary.csv
+phases_all="$OUTPUT_DIR/phases.json"
+echo "[" > $phases_all
+first=1
+for f in $OUTPUT_DIR/*_*/phases_*.json; do
+    [ -f "$f" ] || continue
+    [ $first -eq 1 ] || echo "," >> $phases_all
+    cat "$f" >> $phases_all
+    first=0
+done
+echo "]" >> $phases_all
+
 echo "Performance testing complete. See $OUTPUT_DIR/"
+echo "Analyze with: MODE=$MODE python analyze_results.py"
@@ -3,6 +3,7 @@
 
 import os
 import csv
+import json
 import matplotlib.pyplot as plt
 import numpy as np
 import sys
@@ -130,3 +131,66 @@ if len(summary) > 0:
         print(f"{item['thread_count']:<8} {item['avg_time']:<12.2f} {item['speedup']:<10.2f} {item['efficiency']:<14.2f} {item['avg_memory']/1024:<10.2f}")
 else:
     print("No data available for analysis")
+
+# Bandwidth roofline: achieved GB/s of input per run against the ceilings
+# measured by tools/bw_probe (run at the start of performance_test.sh). A
+# run close to the memory ceiling cannot go faster with more threads;
+# one well below it is still limited by something else.
+bandwidth_file = "performance_data/bandwidth.json"
+if len(summary) > 0 and os.path.exists(bandwidth_file):
+    with open(bandwidth_file) as f:
+        bandwidth = json.load(f)
+    input_bytes = bandwidth.get('file_bytes')
+    memory_ceiling = {m['threads']: m['read_gbs'] for m in bandwidth['memory']}
+    peak_read = bandwidth['peak_memory_read_gbs']
+    storage_gbs = bandwidth.get('storage_read_gbs')
+    page_cache_gbs = bandwidth.get('page_cache_read_gbs')
+
+    # Compute-phase seconds per threads from the -j timing reports, so the
+    # kernel's own bandwidth can be told apart from end-to-end throughput
+    compute_seconds = {}
+    phases_file = "performance_data/phases.json"
+    if os.path.exists(phases_file):
+        with open(phases_file) as f:
+            for run in json.load(f):
+                compute_seconds.setdefault(run['threads'], []).append(run['phases']['compute']['seconds'])
+
+    if not input_bytes:
+        print("\nNo input size in bandwidth.json (run bw_probe with -f); skipping roofline")
+    else:
+        print("\nBandwidth Roofline (GB/s of input):")
+        print("-" * 96)
+        print(f"{'Threads':<10} {'End-to-end':<11} {'%Storage':<9} {'%PageCache':<11} {'Compute':<9} {'Ceiling':<9} {'%Ceiling':<9} {'Verdict'}")
+        print("-" * 96)
+        for item in summary:
+            count = item['thread_count']
+            item['e2e_gbs'] = input_bytes / item['avg_time'] / 1e9 if item['avg_time'] > 0 else 0
+            times = compute_seconds.get(count)
+            item['compute_gbs'] = input_bytes / np.mean(times) / 1e9 if times and np.mean(times) > 0 else None
+            item['ceiling_gbs'] = memory_ceiling.get(count, peak_read)
+            achieved = item['compute_gbs'] if item['compute_gbs'] is not None else item['e2e_gbs']
+            item['ceiling_fraction'] = achieved / item['ceiling_gbs'] if item['ceiling_gbs'] > 0 else 0
+            verdict = "bandwidth-bound" if item['ceiling_fraction'] >= 0.8 else "headroom"
+            storage_pct = f"{100 * item['e2e_gbs'] / storage_gbs:.0f}" if storage_gbs else "-"
+            cache_pct = f"{100 * item['e2e_gbs'] / page_cache_gbs:.0f}" if page_cache_gbs else "-"
+            compute_text = f"{item['compute_gbs']:.2f}" if item['compute_gbs'] is not None else "-"
+            print(f"{count:<10} {item['e2e_gbs']:<11.2f} {storage_pct:<9} {cache_pct:<11} {compute_text:<9} {item['ceiling_gbs']:<9.2f} {100 * item['ceiling_fraction']:<9.0f} {verdict}")
+
+        # Plot 5: Roofline
+        counts = [item['thread_count'] for item in summary]
+        plt.figure(figsize=(10, 6))
+        plt.plot(counts, [item['e2e_gbs'] for item in summary], 'o-', label='End-to-end')
+        if any(item['compute_gbs'] is not None for item in summary):
+            plt.plot(counts, [item['compute_gbs'] or np.nan for item in summary], 's-', label='Compute phase')
+        plt.plot(counts, [item['ceiling_gbs'] for item in summary], 'k--', label='Memory read ceiling')
+        if page_cache_gbs:
+            plt.axhline(page_cache_gbs, color='tab:green', linestyle=':', label='Page-cache read')
+        if storage_gbs:
+            plt.axhline(storage_gbs, color='tab:red', linestyle=':', label='Storage read (cold)')
+        plt.xlabel('Number of Threads')
+        plt.ylabel('Bandwidth (GB/s)')
+        plt.title('Achieved Bandwidth vs Measured Ceilings')
+        plt.grid(True)
+        plt.legend()
+        plt.savefig('plots/roofline.png')
+        print("Roofline plot written to plots/roofline.png")
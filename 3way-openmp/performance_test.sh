@@ -4,12 +4,30 @@
 # Define test parameters
 THREAD_COUNTS=(1 2 4 8 16 20)
 ITERATIONS=3
-INPUT_FILE="/homes/dan/625/wiki_dump.txt"
+INPUT_FILE="${INPUT_FILE:-/homes/dan/625/wiki_dump.txt}"  # Or a tools/gen_corpus file
 OUTPUT_DIR="performance_data"
 
+# Every run also writes per-phase wall times (read, partition, compute,
+# gather, output) as JSON; COUNTERS=1 adds hardware counters to them
+TIMING_FLAGS=""
+if [ "${COUNTERS:-0}" = "1" ]; then
+    TIMING_FLAGS="-c"
+fi
+
 # Create output directory
 mkdir -p $OUTPUT_DIR
 
+# Every implementation is measured through the same maxascii driver, built
+# once with all backends, so runs differ only in the backend they pick
+DRIVER=../common/maxascii
+make -C ../common clean
+make -C ../common MPI=1
+
+# Bandwidth ceilings for analyze_results.py: memory read bandwidth at each
+# count tested below, and storage / page-cache read bandwidth of the input
+make -C ../tools bw_probe
+../tools/bw_probe -t $(IFS=,; echo "${THREAD_COUNTS[*]}") -f $INPUT_FILE -j $OUTPUT_DIR/bandwidth.json
+
 # Function to run tests for each thread count
 run_tests() {
     thread_count=$1
@@ -17,15 +35,12 @@ run_tests() {
     thread_dir="$OUTPUT_DIR/threads_$thread_count"
     mkdir -p $thread_dir
 
-    # Compile
-    make clean
-    make
-
     # Run multiple iterations
     for i in $(seq 1 $ITERATIONS); do
         echo "  Iteration $i of $ITERATIONS"
         output_file="$thread_dir/output_$i.txt"
         stats_file="$thread_dir/stats_$i.txt"
+        phases_file="$thread_dir/phases_$i.json"
 
         # Set thread count and affinity for this test
         export OMP_NUM_THREADS=$thread_count
@@ -33,7 +48,7 @@ run_tests() {
         export OMP_PLACES=cores
         
         # Use /usr/bin/time to capture detailed performance metrics
-        /usr/bin/time -v ./openmp_max_ascii $INPUT_FILE > $output_file 2> $stats_file
+        /usr/bin/time -v $DRIVER -b openmp -t $thread_count $TIMING_FLAGS -j $phases_file $INPUT_FILE > $output_file 2> $stats_file
 
         # Extract key performance metrics and save to a summary file
         echo "Thread count: $thread_count, Iteration: $i" >> "$thread_dir/summary.txt"
@@ -72,4 +87,16 @@ for tc in "${THREAD_COUNTS[@]}"; do
     done
 done
 
+# Collect the per-run phase timings into one JSON array next to summary.csv
+phases_all="$OUTPUT_DIR/phases.json"
+echo "[" > $phases_all
+first=1
+for f in $OUTPUT_DIR/*_*/phases_*.json; do
+    [ -f "$f" ] || continue
+    [ $first -eq 1 ] || echo "," >> $phases_all
+    cat "$f" >> $phases_all
+    first=0
+done
+echo "]" >> $phases_all
+
 echo "Performance testing completed. Results are in $OUTPUT_DIR/"
@@ -4,12 +4,31 @@
 # Define test parameters
 THREAD_COUNTS=(1 2 4 8 16 20)  # Different thread counts to test
 ITERATIONS=3                    # Number of runs per configuration
-INPUT_FILE="/homes/dan/625/wiki_dump.txt"
+INPUT_FILE="${INPUT_FILE:-/homes/dan/625/wiki_dump.txt}"  # Or a tools/gen_corpus file
 OUTPUT_DIR="performance_data"   # Directory to store results
+AFFINITY="${AFFINITY:-compact}" # Thread pinning: none, compact, scatter or numa
+
+# Every run also writes per-phase wall times (read, partition, compute,
+# gather, output) as JSON; COUNTERS=1 adds hardware counters to them
+TIMING_FLAGS=""
+if [ "${COUNTERS:-0}" = "1" ]; then
+    TIMING_FLAGS="-c"
+fi
 
 # Create output directory
 mkdir -p $OUTPUT_DIR
 
+# Every implementation is measured through the same maxascii driver, built
+# once with all backends, so runs differ only in the backend they pick
+DRIVER=../common/maxascii
+make -C ../common clean
+make -C ../common MPI=1
+
+# Bandwidth ceilings for analyze_results.py: memory read bandwidth at each
+# count tested below, and storage / page-cache read bandwidth of the input
+make -C ../tools bw_probe
+../tools/bw_probe -t $(IFS=,; echo "${THREAD_COUNTS[*]}") -f $INPUT_FILE -j $OUTPUT_DIR/bandwidth.json
+
 # Function to run tests for each configuration
 run_tests() {
     thread_count=$1
@@ -20,13 +39,6 @@ run_tests() {
     thread_dir="$OUTPUT_DIR/threads_$thread_count"
     mkdir -p $thread_dir
     
-    # Modify the code to use this thread count
-    sed -i "s/#define NUM_THREADS [0-9]*/#define NUM_THREADS $thread_count/" pthread.c
-    
-    # Compile
-    make clean
-    make
-    
     # Run multiple iterations
     for i in $(seq 1 $ITERATIONS); do
         echo "  Iteration $i of $ITERATIONS"
@@ -34,9 +46,10 @@ run_tests() {
         # Use /usr/bin/time to capture detailed performance metrics
         output_file="$thread_dir/output_$i.txt"
         stats_file="$thread_dir/stats_$i.txt"
+        phases_file="$thread_dir/phases_$i.json"
         
         # Run the executable with time command
-        /usr/bin/time -v ./pthread_max_ascii $INPUT_FILE > $output_file 2> $stats_file
+        /usr/bin/time -v $DRIVER -b pthread -t $thread_count -a $AFFINITY $TIMING_FLAGS -j $phases_file $INPUT_FILE > $output_file 2> $stats_file
         
         # Extract key performance metrics and save to a summary file
         echo "Thread count: $thread_count, Iteration: $i" >> "$thread_dir/summary.txt"
@@ -51,6 +64,7 @@ run_tests() {
 # Main execution
 echo "Starting performance tests..."
 echo "Output will be saved to $OUTPUT_DIR/"
+echo "Thread affinity: $AFFINITY"
 
 # Run tests for each thread count
 for tc in "${THREAD_COUNTS[@]}"; do
@@ -79,4 +93,16 @@ for tc in "${THREAD_COUNTS[@]}"; do
     done
 done
 
+# Collect the per-run phase timings into one JSON array next to summary.csv
+phases_all="$OUTPUT_DIR/phases.json"
+echo "[" > $phases_all
+first=1
+for f in $OUTPUT_DIR/*_*/phases_*.json; do
+    [ -f "$f" ] || continue
+    [ $first -eq 1 ] || echo "," >> $phases_all
+    cat "$f" >> $phases_all
+    first=0
+done
+echo "]" >> $phases_all
+
 echo "Performance testing completed. Results are in $OUTPUT_DIR/"
\ No newline at end of file
@@ -11,7 +11,7 @@
 #SBATCH --error=perf_test_%j.err
 
 # Load required modules as specified in the project description
-module load CMake/3.23.1-GCCcore-11.3.0 foss/2022a
+module load CMake/3.23.1-GCCcore-11.3.0 foss/2022a OpenMPI/4.1.4-GCC-11.3.0
 
 # Print job information
 echo "Running on host: $(hostname)"
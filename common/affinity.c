@@ -0,0 +1,294 @@
+#define _GNU_SOURCE  // cpu_set_t, pthread_setaffinity_np
+
+#include "affinity.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// One CPU the process may run on, with its place in the machine
+typedef struct {
+    int cpu;
+    int package;  // Socket
+    int core;     // Rank of its physical core within the socket
+    int smt;      // 0 for the first hyperthread of a core, 1 for the next...
+    int node;     // NUMA node
+} CpuInfo;
+
+static const char *const policy_names[] = {"none", "compact", "scatter", "numa"};
+
+int parse_affinity_policy(const char *name, AffinityPolicy *policy) {
+    for (int i = 0; i <= AFFINITY_NUMA; i++) {
+        if (strcmp(name, policy_names[i]) == 0) {
+            *policy = (AffinityPolicy)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *affinity_policy_name(AffinityPolicy policy) {
+    return policy_names[policy];
+}
+
+int thread_count_from_env(int fallback) {
+    const char *value = getenv("MAXASCII_THREADS");
+    int n = value ? atoi(value) : 0;
+    return n > 0 ? n : fallback;
+}
+
+int affinity_from_env(AffinityPolicy *policy) {
+    const char *value = getenv("MAXASCII_AFFINITY");
+    *policy = AFFINITY_NONE;
+    if (value && *value && parse_affinity_policy(value, policy) != 0) {
+        fprintf(stderr, "Unknown MAXASCII_AFFINITY policy '%s'\n", value);
+        return -1;
+    }
+    return 0;
+}
+
+// Single integer from a sysfs file, or fallback if it is missing
+static int read_sysfs_int(const char *path, int fallback) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return fallback;
+    }
+    int value;
+    if (fscanf(f, "%d", &value) != 1) {
+        value = fallback;
+    }
+    fclose(f);
+    return value;
+}
+
+// Parse a sysfs cpulist such as "0-3,8-11" into set
+static void read_cpulist(const char *path, cpu_set_t *set) {
+    CPU_ZERO(set);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    int lo, hi;
+    while (fscanf(f, "%d", &lo) == 1) {
+        hi = lo;
+        int c = fgetc(f);
+        if (c == '-') {
+            if (fscanf(f, "%d", &hi) != 1) {
+                break;
+            }
+            c = fgetc(f);
+        }
+        for (int cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, set);
+        }
+        if (c != ',') {
+            break;
+        }
+    }
+    fclose(f);
+}
+
+// Node of every CPU, from /sys/devices/system/node/node*/cpulist. CPUs of
+// a machine without NUMA information all stay on node 0.
+static void read_nodes(CpuInfo *cpus, int count) {
+    DIR *dir = opendir("/sys/devices/system/node");
+    if (!dir) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int node;
+        if (sscanf(entry->d_name, "node%d", &node) != 1) {
+            continue;
+        }
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        cpu_set_t set;
+        read_cpulist(path, &set);
+        for (int i = 0; i < count; i++) {
+            if (CPU_ISSET(cpus[i].cpu, &set)) {
+                cpus[i].node = node;
+            }
+        }
+    }
+    closedir(dir);
+}
+
+static int by_cpu(const void *a, const void *b) {
+    return ((const CpuInfo *)a)->cpu - ((const CpuInfo *)b)->cpu;
+}
+
+// Socket, then first hyperthreads before siblings, then core
+static int compact_order(const void *a, const void *b) {
+    const CpuInfo *x = a, *y = b;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->smt != y->smt) return x->smt - y->smt;
+    if (x->core != y->core) return x->core - y->core;
+    return x->cpu - y->cpu;
+}
+
+// First hyperthreads before siblings, then core, then socket
+static int scatter_order(const void *a, const void *b) {
+    const CpuInfo *x = a, *y = b;
+    if (x->smt != y->smt) return x->smt - y->smt;
+    if (x->core != y->core) return x->core - y->core;
+    if (x->package != y->package) return x->package - y->package;
+    return x->cpu - y->cpu;
+}
+
+// The CPUs this process may use, with socket, core, sibling and node
+static CpuInfo *read_topology(int *count) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        perror("Error reading CPU affinity");
+        return NULL;
+    }
+    int n = CPU_COUNT(&allowed);
+    CpuInfo *cpus = calloc(n > 0 ? n : 1, sizeof(CpuInfo));
+    if (!cpus) {
+        perror("CPU topology allocation failed");
+        return NULL;
+    }
+
+    // Raw socket and core ids; core ids are only unique within a socket
+    int *core_ids = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!core_ids) {
+        perror("CPU topology allocation failed");
+        free(cpus);
+        return NULL;
+    }
+    int k = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && k < n; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        char path[128];
+        cpus[k].cpu = cpu;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        cpus[k].package = read_sysfs_int(path, 0);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+        core_ids[k] = read_sysfs_int(path, cpu);
+        k++;
+    }
+    read_nodes(cpus, n);
+
+    // Number the cores of each socket densely, and the hyperthreads of each
+    // core in CPU order. CPUs are already in CPU order, so an earlier CPU on
+    // the same core is always a lower sibling.
+    for (int i = 0; i < n; i++) {
+        int rank = 0;
+        cpus[i].smt = 0;
+        cpus[i].core = -1;
+        for (int j = 0; j < i; j++) {
+            if (cpus[j].package != cpus[i].package) {
+                continue;
+            }
+            if (core_ids[j] == core_ids[i]) {
+                cpus[i].core = cpus[j].core;
+                cpus[i].smt++;
+            } else if (cpus[j].smt == 0) {
+                rank++;
+            }
+        }
+        if (cpus[i].core < 0) {
+            cpus[i].core = rank;
+        }
+    }
+    free(core_ids);
+    *count = n;
+    return cpus;
+}
+
+int cpu_placement_init(CpuPlacement *placement, AffinityPolicy policy, int num_threads) {
+    placement->policy = policy;
+    placement->num_threads = num_threads;
+    placement->slots = NULL;
+    if (policy == AFFINITY_NONE) {
+        return 0;
+    }
+
+    int n;
+    CpuInfo *cpus = read_topology(&n);
+    if (!cpus) {
+        return -1;
+    }
+    cpu_set_t *slots = calloc(num_threads, sizeof(cpu_set_t));
+    if (!slots || n == 0) {
+        if (n == 0) {
+            fprintf(stderr, "Error: no CPUs available for placement\n");
+        } else {
+            perror("CPU placement allocation failed");
+        }
+        free(slots);
+        free(cpus);
+        return -1;
+    }
+
+    if (policy == AFFINITY_NUMA) {
+        // Distinct nodes in ascending order; thread i gets node
+        // i * nodes / num_threads, so neighbouring threads share a node
+        qsort(cpus, n, sizeof(CpuInfo), by_cpu);
+        int *nodes = malloc(n * sizeof(int));
+        if (!nodes) {
+            perror("CPU placement allocation failed");
+            free(slots);
+            free(cpus);
+            return -1;
+        }
+        int num_nodes = 0;
+        for (int i = 0; i < n; i++) {
+            int seen = 0;
+            for (int j = 0; j < num_nodes; j++) {
+                seen |= (nodes[j] == cpus[i].node);
+            }
+            if (!seen) {
+                int j = num_nodes++;
+                while (j > 0 && nodes[j - 1] > cpus[i].node) {
+                    nodes[j] = nodes[j - 1];
+                    j--;
+                }
+                nodes[j] = cpus[i].node;
+            }
+        }
+        for (int t = 0; t < num_threads; t++) {
+            int node = nodes[(long long)t * num_nodes / num_threads];
+            for (int i = 0; i < n; i++) {
+                if (cpus[i].node == node) {
+                    CPU_SET(cpus[i].cpu, &slots[t]);
+                }
+            }
+        }
+        free(nodes);
+    } else {
+        qsort(cpus, n, sizeof(CpuInfo), policy == AFFINITY_COMPACT ? compact_order : scatter_order);
+        for (int t = 0; t < num_threads; t++) {
+            CPU_SET(cpus[t % n].cpu, &slots[t]);
+        }
+    }
+
+    free(cpus);
+    placement->slots = slots;
+    return 0;
+}
+
+int cpu_placement_pin_self(const CpuPlacement *placement, int index) {
+    if (!placement || !placement->slots) {
+        return 0;
+    }
+    const cpu_set_t *slots = placement->slots;
+    const cpu_set_t *slot = &slots[index % placement->num_threads];
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), slot);
+    if (rc != 0) {
+        fprintf(stderr, "Error pinning thread %d: %s\n", index, strerror(rc));
+        return -1;
+    }
+    return 0;
+}
+
+void cpu_placement_free(CpuPlacement *placement) {
+    free(placement->slots);
+    placement->slots = NULL;
+}
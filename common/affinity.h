@@ -0,0 +1,54 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+// Runtime thread count and CPU placement for worker threads.
+//
+// Policies, applied within the CPUs the process is allowed to run on (so a
+// SLURM cpuset or taskset mask is respected):
+//   none     leave placement to the scheduler (the old behaviour)
+//   compact  fill one socket's physical cores first, then their hyperthread
+//            siblings, then the next socket; threads share caches
+//   scatter  round-robin over sockets, then cores, siblings last; spreads
+//            threads over as many memory controllers as possible
+//   numa     bind contiguous groups of threads to whole NUMA nodes, so each
+//            thread's first-touch pages stay on its node
+// Compact and scatter bind each thread to a single CPU, wrapping around when
+// there are more threads than CPUs. Topology comes from sysfs; without it
+// every CPU counts as its own core on socket 0, node 0.
+
+typedef enum {
+    AFFINITY_NONE,
+    AFFINITY_COMPACT,
+    AFFINITY_SCATTER,
+    AFFINITY_NUMA
+} AffinityPolicy;
+
+// Where each of num_threads workers runs: slots[i] for thread i
+typedef struct {
+    AffinityPolicy policy;
+    int num_threads;
+    void *slots;       // cpu_set_t per thread; NULL for AFFINITY_NONE
+} CpuPlacement;
+
+// Parse "none", "compact", "scatter" or "numa". Returns 0 or -1.
+int parse_affinity_policy(const char *name, AffinityPolicy *policy);
+const char *affinity_policy_name(AffinityPolicy policy);
+
+// Worker thread count: MAXASCII_THREADS if set to a positive number,
+// otherwise fallback. An explicit command-line count overrides both.
+int thread_count_from_env(int fallback);
+
+// Affinity policy from MAXASCII_AFFINITY, otherwise AFFINITY_NONE.
+// Returns 0, or -1 if the variable holds an unknown policy.
+int affinity_from_env(AffinityPolicy *policy);
+
+// Plan the placement of num_threads workers. Returns 0 or -1.
+int cpu_placement_init(CpuPlacement *placement, AffinityPolicy policy, int num_threads);
+
+// Bind the calling thread to its slot (worker index modulo num_threads).
+// A no-op for AFFINITY_NONE. Returns 0, or -1 if the kernel refused.
+int cpu_placement_pin_self(const CpuPlacement *placement, int index);
+
+void cpu_placement_free(CpuPlacement *placement);
+
+#endif
@@ -0,0 +1,796 @@
+#include "ascii_kernel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar reference
+// ---------------------------------------------------------------------------
+
+static int always_supported(void) {
+    return 1;
+}
+
+static int max_span_scalar(const char *line, size_t len) {
+    int max_value = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)line[i];
+        if (c > max_value) {
+            max_value = c;
+        }
+    }
+    return max_value;
+}
+
+static size_t scan_line_scalar(const char *text, size_t avail, int *max_value) {
+    int m = 0;
+    size_t i = 0;
+    for (; i < avail; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '\n') {
+            break;
+        }
+        if (c > m) {
+            m = c;
+        }
+    }
+    *max_value = m;
+    return i;
+}
+
+// Control bytes: C0 controls other than tab, and DEL
+static inline int is_control(unsigned char c) {
+    return (c < 0x20 && c != '\t') || c == 0x7f;
+}
+
+static void stats_span_scalar(const char *line, size_t len, LineStats *stats) {
+    unsigned max_value = 0, min_value = 0xff, control = 0;
+    uint64_t non_ascii = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)line[i];
+        max_value = (c > max_value) ? c : max_value;
+        min_value = (c < min_value) ? c : min_value;
+        non_ascii += c >> 7;
+        control |= is_control(c);
+    }
+    stats->length = len;
+    stats->non_ascii = non_ascii;
+    stats->max = (uint8_t)max_value;
+    stats->min = len ? (uint8_t)min_value : 0;
+    stats->control = (uint8_t)control;
+}
+
+// Length of the well-formed UTF-8 sequence at s[0..avail), with its
+// codepoint in *cp, or 0 if there is none: stray continuation bytes,
+// overlong forms, surrogates, values past U+10FFFF and truncation
+static inline size_t utf8_decode_checked(const unsigned char *s, size_t avail, uint32_t *cp) {
+    unsigned char c = s[0];
+    if (c < 0x80) {
+        *cp = c;
+        return 1;
+    }
+    size_t n;
+    uint32_t value, min_value;
+    if (c < 0xc2) {
+        return 0;
+    } else if (c < 0xe0) {
+        n = 2, value = c & 0x1f, min_value = 0x80;
+    } else if (c < 0xf0) {
+        n = 3, value = c & 0x0f, min_value = 0x800;
+    } else if (c < 0xf5) {
+        n = 4, value = c & 0x07, min_value = 0x10000;
+    } else {
+        return 0;
+    }
+    if (avail < n) {
+        return 0;
+    }
+    for (size_t k = 1; k < n; k++) {
+        if ((s[k] & 0xc0) != 0x80) {
+            return 0;
+        }
+        value = (value << 6) | (s[k] & 0x3f);
+    }
+    if (value < min_value || value > 0x10ffff || (value >= 0xd800 && value <= 0xdfff)) {
+        return 0;
+    }
+    *cp = value;
+    return n;
+}
+
+// An ill-formed byte counts as U+FFFD, as a decoder would substitute it
+#define UTF8_REPLACEMENT 0xfffd
+
+// A lead byte is larger than its continuation bytes, so the first byte of
+// each decoded unit is enough to track the max byte as well
+static void utf8_span_scalar(const char *line, size_t len, LineStats *stats) {
+    const unsigned char *s = (const unsigned char *)line;
+    uint32_t max_cp = 0;
+    unsigned max_byte = 0;
+    int bad = 0;
+    size_t i = 0;
+    while (i < len) {
+        uint32_t cp;
+        size_t n = utf8_decode_checked(s + i, len - i, &cp);
+        if (n == 0) {
+            cp = UTF8_REPLACEMENT;
+            n = 1;
+            bad = 1;
+        }
+        max_cp = (cp > max_cp) ? cp : max_cp;
+        max_byte = (s[i] > max_byte) ? s[i] : max_byte;
+        i += n;
+    }
+    stats->max = (uint8_t)max_byte;
+    stats->codepoint = max_cp;
+    stats->invalid = (uint8_t)bad;
+}
+
+// Max codepoint of a line already known to be valid UTF-8 whose largest
+// byte is the lead byte lead. Continuation bytes are at most 0xBF and lead
+// bytes at least 0xC2, so the largest codepoint starts with the largest
+// byte; only the sequences starting with it need decoding.
+static uint32_t utf8_max_with_lead(const char *line, size_t len, unsigned char lead) {
+    const char *end = line + len;
+    uint32_t max_cp = 0;
+    for (const char *p = memchr(line, lead, len); p; p = memchr(p + 1, lead, (size_t)(end - p - 1))) {
+        uint32_t cp = 0;
+        utf8_decode_checked((const unsigned char *)p, (size_t)(end - p), &cp);
+        max_cp = (cp > max_cp) ? cp : max_cp;
+    }
+    return max_cp;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+// ---------------------------------------------------------------------------
+// SSE2: 16 bytes per compare, 64 bytes per loop iteration
+// ---------------------------------------------------------------------------
+
+static int supports_sse2(void) {
+    return __builtin_cpu_supports("sse2");
+}
+
+__attribute__((target("sse2")))
+static inline int hmax_epu8_128(__m128i v) {
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 4));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 2));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 1));
+    return _mm_cvtsi128_si32(v) & 0xff;
+}
+
+__attribute__((target("sse2")))
+static int max_span_sse2(const char *line, size_t len) {
+    if (len < 16) {
+        return max_span_scalar(line, len);
+    }
+
+    __m128i m0 = _mm_setzero_si128(), m1 = m0, m2 = m0, m3 = m0;
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        m0 = _mm_max_epu8(m0, _mm_loadu_si128((const __m128i *)(line + i)));
+        m1 = _mm_max_epu8(m1, _mm_loadu_si128((const __m128i *)(line + i + 16)));
+        m2 = _mm_max_epu8(m2, _mm_loadu_si128((const __m128i *)(line + i + 32)));
+        m3 = _mm_max_epu8(m3, _mm_loadu_si128((const __m128i *)(line + i + 48)));
+    }
+    for (; i + 16 <= len; i += 16) {
+        m0 = _mm_max_epu8(m0, _mm_loadu_si128((const __m128i *)(line + i)));
+    }
+    // Max is idempotent, so the tail can overlap bytes already seen
+    if (i < len) {
+        m1 = _mm_max_epu8(m1, _mm_loadu_si128((const __m128i *)(line + len - 16)));
+    }
+    return hmax_epu8_128(_mm_max_epu8(_mm_max_epu8(m0, m1), _mm_max_epu8(m2, m3)));
+}
+
+__attribute__((target("sse2")))
+static size_t scan_line_sse2(const char *text, size_t avail, int *max_value) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i iota = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i vmax = _mm_setzero_si128();
+    size_t i = 0;
+
+    // Fast path: 64 bytes at a time while no newline is in sight
+    for (; i + 64 <= avail; i += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(text + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(text + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(text + i + 48));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(a, nl), _mm_cmpeq_epi8(b, nl)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(c, nl), _mm_cmpeq_epi8(d, nl)));
+        if (_mm_movemask_epi8(hit)) {
+            break;
+        }
+        vmax = _mm_max_epu8(vmax, _mm_max_epu8(_mm_max_epu8(a, b), _mm_max_epu8(c, d)));
+    }
+    for (; i + 16 <= avail; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        if (mask) {
+            int idx = __builtin_ctz(mask);
+            // Keep only the lanes before the newline
+            __m128i keep = _mm_cmplt_epi8(iota, _mm_set1_epi8((char)idx));
+            vmax = _mm_max_epu8(vmax, _mm_and_si128(v, keep));
+            *max_value = hmax_epu8_128(vmax);
+            return i + idx;
+        }
+        vmax = _mm_max_epu8(vmax, v);
+    }
+
+    int tail_max;
+    size_t tail = scan_line_scalar(text + i, avail - i, &tail_max);
+    int m = hmax_epu8_128(vmax);
+    *max_value = (tail_max > m) ? tail_max : m;
+    return i + tail;
+}
+
+__attribute__((target("sse2")))
+static inline int hmin_epu8_128(__m128i v) {
+    v = _mm_min_epu8(v, _mm_srli_si128(v, 8));
+    v = _mm_min_epu8(v, _mm_srli_si128(v, 4));
+    v = _mm_min_epu8(v, _mm_srli_si128(v, 2));
+    v = _mm_min_epu8(v, _mm_srli_si128(v, 1));
+    return _mm_cvtsi128_si32(v) & 0xff;
+}
+
+// Sum of the 16 byte lanes
+__attribute__((target("sse2")))
+static inline uint64_t hsum_epu8_128(__m128i v) {
+    __m128i sums = _mm_sad_epu8(v, _mm_setzero_si128());
+    return (uint64_t)_mm_cvtsi128_si32(sums) + (uint64_t)_mm_extract_epi16(sums, 4);
+}
+
+// 0xff in every lane holding a control byte
+__attribute__((target("sse2")))
+static inline __m128i control_mask_128(__m128i v) {
+    __m128i c0 = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+    c0 = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), c0);
+    return _mm_or_si128(c0, _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)));
+}
+
+// Every metric in one pass. Non-ASCII bytes are counted per lane (each hit
+// subtracts -1), and the lanes are summed before any can reach 256. Max,
+// min and the control flag are idempotent, so the tail reloads the last 16
+// bytes; only the count has to skip the lanes already seen.
+__attribute__((target("sse2")))
+static void stats_span_sse2(const char *line, size_t len, LineStats *stats) {
+    if (len < 16) {
+        stats_span_scalar(line, len, stats);
+        return;
+    }
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vmax = zero, vmin = _mm_set1_epi8((char)0xff), control = zero;
+    uint64_t non_ascii = 0;
+
+    size_t i = 0;
+    while (i + 32 <= len) {
+        // Two hits per lane per iteration: 127 iterations fit in a byte
+        size_t end = (len - i > 127 * 32) ? i + 127 * 32 : len;
+        __m128i counts = zero;
+        for (; i + 32 <= end; i += 32) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(line + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(line + i + 16));
+            vmax = _mm_max_epu8(vmax, _mm_max_epu8(a, b));
+            vmin = _mm_min_epu8(vmin, _mm_min_epu8(a, b));
+            counts = _mm_sub_epi8(counts, _mm_cmplt_epi8(a, zero));
+            counts = _mm_sub_epi8(counts, _mm_cmplt_epi8(b, zero));
+            control = _mm_or_si128(control, _mm_or_si128(control_mask_128(a), control_mask_128(b)));
+        }
+        non_ascii += hsum_epu8_128(counts);
+    }
+    for (int step = 0; step < 2 && i < len; step++) {
+        // A whole vector, then the overlapping tail
+        size_t at = (i + 16 <= len) ? i : len - 16;
+        __m128i v = _mm_loadu_si128((const __m128i *)(line + at));
+        vmax = _mm_max_epu8(vmax, v);
+        vmin = _mm_min_epu8(vmin, v);
+        control = _mm_or_si128(control, control_mask_128(v));
+        unsigned high = (unsigned)_mm_movemask_epi8(v) >> (i - at);
+        non_ascii += (uint64_t)__builtin_popcount(high);
+        i = at + 16;
+    }
+    stats->length = len;
+    stats->non_ascii = non_ascii;
+    stats->max = (uint8_t)hmax_epu8_128(vmax);
+    stats->min = (uint8_t)hmin_epu8_128(vmin);
+    stats->control = _mm_movemask_epi8(control) != 0;
+}
+
+// Scalar decoding, but runs of 16 ASCII bytes are taken a vector at a time
+// (SSE2 has no byte shuffle for the table-driven validator below)
+__attribute__((target("sse2")))
+static void utf8_span_sse2(const char *line, size_t len, LineStats *stats) {
+    const unsigned char *s = (const unsigned char *)line;
+    __m128i vmax = _mm_setzero_si128();
+    uint32_t max_cp = 0;
+    unsigned max_byte = 0;
+    int bad = 0;
+    size_t i = 0;
+    while (i < len) {
+        if (i + 16 <= len) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(line + i));
+            if (_mm_movemask_epi8(v) == 0) {
+                vmax = _mm_max_epu8(vmax, v);
+                i += 16;
+                continue;
+            }
+        }
+        uint32_t cp;
+        size_t n = utf8_decode_checked(s + i, len - i, &cp);
+        if (n == 0) {
+            cp = UTF8_REPLACEMENT;
+            n = 1;
+            bad = 1;
+        }
+        max_cp = (cp > max_cp) ? cp : max_cp;
+        max_byte = (s[i] > max_byte) ? s[i] : max_byte;
+        i += n;
+    }
+    unsigned ascii_max = (unsigned)hmax_epu8_128(vmax);
+    stats->max = (uint8_t)((ascii_max > max_byte) ? ascii_max : max_byte);
+    stats->codepoint = (ascii_max > max_cp) ? ascii_max : max_cp;
+    stats->invalid = (uint8_t)bad;
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: 32 bytes per compare, 64/128 bytes per loop iteration
+// ---------------------------------------------------------------------------
+
+static int supports_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("avx2")))
+static inline int hmax_epu8_256(__m256i v) {
+    __m128i m = _mm_max_epu8(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+    return _mm_cvtsi128_si32(m) & 0xff;
+}
+
+__attribute__((target("avx2")))
+static int max_span_avx2(const char *line, size_t len) {
+    if (len < 32) {
+        return max_span_sse2(line, len);
+    }
+
+    __m256i m0 = _mm256_setzero_si256(), m1 = m0, m2 = m0, m3 = m0;
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        m0 = _mm256_max_epu8(m0, _mm256_loadu_si256((const __m256i *)(line + i)));
+        m1 = _mm256_max_epu8(m1, _mm256_loadu_si256((const __m256i *)(line + i + 32)));
+        m2 = _mm256_max_epu8(m2, _mm256_loadu_si256((const __m256i *)(line + i + 64)));
+        m3 = _mm256_max_epu8(m3, _mm256_loadu_si256((const __m256i *)(line + i + 96)));
+    }
+    for (; i + 32 <= len; i += 32) {
+        m0 = _mm256_max_epu8(m0, _mm256_loadu_si256((const __m256i *)(line + i)));
+    }
+    if (i < len) {
+        m1 = _mm256_max_epu8(m1, _mm256_loadu_si256((const __m256i *)(line + len - 32)));
+    }
+    return hmax_epu8_256(_mm256_max_epu8(_mm256_max_epu8(m0, m1), _mm256_max_epu8(m2, m3)));
+}
+
+__attribute__((target("avx2")))
+static size_t scan_line_avx2(const char *text, size_t avail, int *max_value) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i iota = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                          16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+    __m256i vmax = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 64 <= avail; i += 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(text + i + 32));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(a, nl), _mm256_cmpeq_epi8(b, nl));
+        if (_mm256_movemask_epi8(hit)) {
+            break;
+        }
+        vmax = _mm256_max_epu8(vmax, _mm256_max_epu8(a, b));
+    }
+    for (; i + 32 <= avail; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+        if (mask) {
+            int idx = __builtin_ctz(mask);
+            __m256i keep = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)idx), iota);
+            vmax = _mm256_max_epu8(vmax, _mm256_and_si256(v, keep));
+            *max_value = hmax_epu8_256(vmax);
+            return i + idx;
+        }
+        vmax = _mm256_max_epu8(vmax, v);
+    }
+
+    int tail_max;
+    size_t tail = scan_line_sse2(text + i, avail - i, &tail_max);
+    int m = hmax_epu8_256(vmax);
+    *max_value = (tail_max > m) ? tail_max : m;
+    return i + tail;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i control_mask_256(__m256i v) {
+    __m256i c0 = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);
+    c0 = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), c0);
+    return _mm256_or_si256(c0, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)));
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t hsum_epu8_256(__m256i v) {
+    __m256i sums = _mm256_sad_epu8(v, _mm256_setzero_si256());
+    __m128i pair = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    return (uint64_t)_mm_cvtsi128_si64(pair) + (uint64_t)_mm_extract_epi64(pair, 1);
+}
+
+// Same scheme as stats_span_sse2 at twice the width
+__attribute__((target("avx2,popcnt")))
+static void stats_span_avx2(const char *line, size_t len, LineStats *stats) {
+    if (len < 32) {
+        stats_span_sse2(line, len, stats);
+        return;
+    }
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i vmax = zero, vmin = _mm256_set1_epi8((char)0xff), control = zero;
+    uint64_t non_ascii = 0;
+
+    size_t i = 0;
+    while (i + 64 <= len) {
+        size_t end = (len - i > 127 * 64) ? i + 127 * 64 : len;
+        __m256i counts = zero;
+        for (; i + 64 <= end; i += 64) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(line + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(line + i + 32));
+            vmax = _mm256_max_epu8(vmax, _mm256_max_epu8(a, b));
+            vmin = _mm256_min_epu8(vmin, _mm256_min_epu8(a, b));
+            counts = _mm256_sub_epi8(counts, _mm256_cmpgt_epi8(zero, a));
+            counts = _mm256_sub_epi8(counts, _mm256_cmpgt_epi8(zero, b));
+            control = _mm256_or_si256(control, _mm256_or_si256(control_mask_256(a), control_mask_256(b)));
+        }
+        non_ascii += hsum_epu8_256(counts);
+    }
+    for (int step = 0; step < 2 && i < len; step++) {
+        size_t at = (i + 32 <= len) ? i : len - 32;
+        __m256i v = _mm256_loadu_si256((const __m256i *)(line + at));
+        vmax = _mm256_max_epu8(vmax, v);
+        vmin = _mm256_min_epu8(vmin, v);
+        control = _mm256_or_si256(control, control_mask_256(v));
+        unsigned high = (unsigned)_mm256_movemask_epi8(v) >> (i - at);
+        non_ascii += (uint64_t)__builtin_popcount(high);
+        i = at + 32;
+    }
+    __m128i lo = _mm_min_epu8(_mm256_castsi256_si128(vmin), _mm256_extracti128_si256(vmin, 1));
+    stats->length = len;
+    stats->non_ascii = non_ascii;
+    stats->max = (uint8_t)hmax_epu8_256(vmax);
+    stats->min = (uint8_t)hmin_epu8_128(lo);
+    stats->control = _mm256_movemask_epi8(control) != 0;
+}
+
+// UTF-8 validation after Keiser and Lemire, "Validating UTF-8 in less than
+// one instruction per byte" (2021). Three 16-entry table lookups, indexed
+// by the high and low nibble of the previous byte and the high nibble of
+// the current one, flag every ill-formed two-byte pattern; a saturating
+// subtract finds the bytes that must continue a three- or four-byte
+// sequence. Pure-ASCII 64-byte blocks skip both and only check that the
+// previous block did not end mid-sequence; testing at 64 rather than 32
+// bytes keeps the branch predictable on text with scattered non-ASCII.
+#define UTF8_TOO_SHORT (1 << 0)   // Lead byte not followed by a continuation
+#define UTF8_TOO_LONG (1 << 1)    // ASCII followed by a continuation
+#define UTF8_OVERLONG_3 (1 << 2)  // E0 80..9F
+#define UTF8_TOO_LARGE (1 << 3)   // F4 90..BF, F5..FF
+#define UTF8_SURROGATE (1 << 4)   // ED A0..BF
+#define UTF8_OVERLONG_2 (1 << 5)  // C0, C1
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4 (1 << 6)  // F0 80..8F
+#define UTF8_TWO_CONTS (1 << 7)   // Continuation not preceded by a lead
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+// The last n bytes of prev followed by the first 32 - n of input
+#define UTF8_PREV_256(input, prev, n) \
+    _mm256_alignr_epi8((input), _mm256_permute2x128_si256((prev), (input), 0x21), 16 - (n))
+
+__attribute__((target("avx2")))
+static inline __m256i utf8_lookup_256(__m256i nibbles, __m128i table) {
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(table), nibbles);
+}
+
+// Nonzero lanes where input, following prev, is not well-formed
+__attribute__((target("avx2")))
+static inline __m256i utf8_errors_256(__m256i input, __m256i prev) {
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+    const __m128i byte_1_high_table = _mm_setr_epi8(
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+    const __m128i byte_1_low_table = _mm_setr_epi8(
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+        UTF8_CARRY | UTF8_OVERLONG_2,
+        UTF8_CARRY,
+        UTF8_CARRY,
+        UTF8_CARRY | UTF8_TOO_LARGE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000);
+    const __m128i byte_2_high_table = _mm_setr_epi8(
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+
+    __m256i prev1 = UTF8_PREV_256(input, prev, 1);
+    __m256i byte_1_high = utf8_lookup_256(_mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble),
+                                          byte_1_high_table);
+    __m256i byte_1_low = utf8_lookup_256(_mm256_and_si256(prev1, low_nibble), byte_1_low_table);
+    __m256i byte_2_high = utf8_lookup_256(_mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble),
+                                          byte_2_high_table);
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    // Third and fourth bytes must be continuations: their bit 7 here is
+    // set exactly when the byte two (three) back is an E0+ (F0+) lead
+    __m256i third = _mm256_subs_epu8(UTF8_PREV_256(input, prev, 2), _mm256_set1_epi8((char)(0xe0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(UTF8_PREV_256(input, prev, 3), _mm256_set1_epi8((char)(0xf0 - 0x80)));
+    __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must_continue, special);
+}
+
+// Nonzero if input ends inside a multi-byte sequence
+__attribute__((target("avx2")))
+static inline __m256i utf8_incomplete_256(__m256i input) {
+    const __m256i max_value = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+    return _mm256_subs_epu8(input, max_value);
+}
+
+// Validate the whole line and track the max byte. A valid line's max
+// codepoint then comes from its largest lead byte; invalid lines, which
+// should be rare, go to the scalar decoder for the U+FFFD accounting.
+__attribute__((target("avx2")))
+static void utf8_span_avx2(const char *line, size_t len, LineStats *stats) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i prev = zero, prev_incomplete = zero, error = zero, vmax = zero;
+    for (size_t i = 0; i < len; i += 64) {
+        __m256i a, b;
+        if (len - i >= 64) {
+            a = _mm256_loadu_si256((const __m256i *)(line + i));
+            b = _mm256_loadu_si256((const __m256i *)(line + i + 32));
+        } else {
+            // Zero padding is ASCII, so a sequence cut off by the end of
+            // the line still shows up as too short
+            char tail[64] = {0};
+            memcpy(tail, line + i, len - i);
+            a = _mm256_loadu_si256((const __m256i *)tail);
+            b = _mm256_loadu_si256((const __m256i *)(tail + 32));
+        }
+        __m256i both = _mm256_or_si256(a, b);
+        vmax = _mm256_max_epu8(vmax, _mm256_max_epu8(a, b));
+        if (_mm256_movemask_epi8(both) == 0) {
+            error = _mm256_or_si256(error, prev_incomplete);
+            prev_incomplete = zero;
+        } else {
+            error = _mm256_or_si256(error, utf8_errors_256(a, prev));
+            error = _mm256_or_si256(error, utf8_errors_256(b, a));
+            prev_incomplete = utf8_incomplete_256(b);
+        }
+        prev = b;
+    }
+    error = _mm256_or_si256(error, prev_incomplete);
+    if (!_mm256_testz_si256(error, error)) {
+        utf8_span_scalar(line, len, stats);
+        return;
+    }
+    int max_byte = hmax_epu8_256(vmax);
+    stats->max = (uint8_t)max_byte;
+    stats->codepoint = (max_byte < 0x80) ? (uint32_t)max_byte
+                                         : utf8_max_with_lead(line, len, (unsigned char)max_byte);
+    stats->invalid = 0;
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512BW: 64 bytes per compare; masked loads handle the tail
+// ---------------------------------------------------------------------------
+
+static int supports_avx512bw(void) {
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline int hmax_epu8_512(__m512i v) {
+    __m256i h = _mm256_max_epu8(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1));
+    __m128i m = _mm_max_epu8(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+    return _mm_cvtsi128_si32(m) & 0xff;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int max_span_avx512bw(const char *line, size_t len) {
+    __m512i m0 = _mm512_setzero_si512(), m1 = m0, m2 = m0, m3 = m0;
+    size_t i = 0;
+    for (; i + 256 <= len; i += 256) {
+        m0 = _mm512_max_epu8(m0, _mm512_loadu_si512(line + i));
+        m1 = _mm512_max_epu8(m1, _mm512_loadu_si512(line + i + 64));
+        m2 = _mm512_max_epu8(m2, _mm512_loadu_si512(line + i + 128));
+        m3 = _mm512_max_epu8(m3, _mm512_loadu_si512(line + i + 192));
+    }
+    for (; i + 64 <= len; i += 64) {
+        m0 = _mm512_max_epu8(m0, _mm512_loadu_si512(line + i));
+    }
+    if (i < len) {
+        // Masked-off lanes load as zero and never fault
+        __mmask64 k = (~0ULL) >> (64 - (len - i));
+        m1 = _mm512_max_epu8(m1, _mm512_maskz_loadu_epi8(k, line + i));
+    }
+    return hmax_epu8_512(_mm512_max_epu8(_mm512_max_epu8(m0, m1), _mm512_max_epu8(m2, m3)));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t scan_line_avx512bw(const char *text, size_t avail, int *max_value) {
+    const __m512i nl = _mm512_set1_epi8('\n');
+    __m512i vmax = _mm512_setzero_si512();
+    size_t i = 0;
+
+    for (; i < avail; i += 64) {
+        __mmask64 valid = (avail - i >= 64) ? ~0ULL : (~0ULL) >> (64 - (avail - i));
+        __m512i v = _mm512_maskz_loadu_epi8(valid, text + i);
+        __mmask64 hit = _mm512_mask_cmpeq_epi8_mask(valid, v, nl);
+        if (hit) {
+            int idx = __builtin_ctzll(hit);
+            __mmask64 keep = (idx == 0) ? 0 : (~0ULL) >> (64 - idx);
+            vmax = _mm512_mask_max_epu8(vmax, keep, vmax, v);
+            *max_value = hmax_epu8_512(vmax);
+            return i + idx;
+        }
+        vmax = _mm512_max_epu8(vmax, v);
+    }
+    *max_value = hmax_epu8_512(vmax);
+    return avail;
+}
+
+// Compares produce bit masks here, so the count is a popcount per vector
+// and the tail is a masked load, as in max_span_avx512bw. Control bytes
+// other than DEL are found through a second min that skips tab lanes.
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static void stats_span_avx512bw(const char *line, size_t len, LineStats *stats) {
+    const __m512i tab = _mm512_set1_epi8('\t');
+    const __m512i del = _mm512_set1_epi8(0x7f);
+    const __m512i ones = _mm512_set1_epi8((char)0xff);
+    __m512i vmax = _mm512_setzero_si512(), vmin = ones, cmin = ones;
+    __mmask64 has_del = 0;
+    uint64_t non_ascii = 0;
+
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        __m512i a = _mm512_loadu_si512(line + i);
+        __m512i b = _mm512_loadu_si512(line + i + 64);
+        vmax = _mm512_max_epu8(vmax, _mm512_max_epu8(a, b));
+        vmin = _mm512_min_epu8(vmin, _mm512_min_epu8(a, b));
+        non_ascii += (uint64_t)__builtin_popcountll(_mm512_movepi8_mask(a)) +
+                     (uint64_t)__builtin_popcountll(_mm512_movepi8_mask(b));
+        cmin = _mm512_mask_min_epu8(cmin, _mm512_cmpneq_epi8_mask(a, tab), cmin, a);
+        cmin = _mm512_mask_min_epu8(cmin, _mm512_cmpneq_epi8_mask(b, tab), cmin, b);
+        has_del |= _mm512_cmpeq_epi8_mask(a, del) | _mm512_cmpeq_epi8_mask(b, del);
+    }
+    for (; i < len; i += 64) {
+        __mmask64 valid = (len - i >= 64) ? ~0ULL : (~0ULL) >> (64 - (len - i));
+        // Masked-off lanes load as 0xff, which min and the control test
+        // ignore; max and the count apply the valid mask instead
+        __m512i v = _mm512_mask_loadu_epi8(ones, valid, line + i);
+        vmax = _mm512_mask_max_epu8(vmax, valid, vmax, v);
+        vmin = _mm512_min_epu8(vmin, v);
+        non_ascii += (uint64_t)__builtin_popcountll(_mm512_movepi8_mask(v) & valid);
+        cmin = _mm512_mask_min_epu8(cmin, _mm512_cmpneq_epi8_mask(v, tab), cmin, v);
+        has_del |= _mm512_cmpeq_epi8_mask(v, del);
+    }
+    __m256i h = _mm256_min_epu8(_mm512_castsi512_si256(vmin), _mm512_extracti64x4_epi64(vmin, 1));
+    __m128i lo = _mm_min_epu8(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+    stats->length = len;
+    stats->non_ascii = non_ascii;
+    stats->max = (uint8_t)hmax_epu8_512(vmax);
+    stats->min = len ? (uint8_t)hmin_epu8_128(lo) : 0;
+    stats->control = has_del || _mm512_cmplt_epu8_mask(cmin, _mm512_set1_epi8(0x20)) != 0;
+}
+
+#endif  // HAVE_X86_KERNELS
+
+// ---------------------------------------------------------------------------
+// Variant table and startup dispatch
+// ---------------------------------------------------------------------------
+
+const AsciiKernel ascii_kernels[] = {
+    {"scalar", max_span_scalar, scan_line_scalar, always_supported, stats_span_scalar,
+     utf8_span_scalar},
+#ifdef HAVE_X86_KERNELS
+    {"sse2", max_span_sse2, scan_line_sse2, supports_sse2, stats_span_sse2, utf8_span_sse2},
+    {"avx2", max_span_avx2, scan_line_avx2, supports_avx2, stats_span_avx2, utf8_span_avx2},
+    // The UTF-8 validator stays at AVX2 width
+    {"avx512bw", max_span_avx512bw, scan_line_avx512bw, supports_avx512bw, stats_span_avx512bw,
+     utf8_span_avx2},
+#endif
+};
+const int ascii_kernel_count = sizeof(ascii_kernels) / sizeof(ascii_kernels[0]);
+
+static const AsciiKernel *active_kernel = &ascii_kernels[0];
+
+// Runs before main so the dispatched entry points are ready before any
+// worker thread or rank touches them
+__attribute__((constructor))
+static void select_kernel(void) {
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+#endif
+    const char *forced = getenv("ASCII_KERNEL");
+
+    for (int i = ascii_kernel_count - 1; i >= 0; i--) {
+        if (!ascii_kernels[i].supported()) {
+            continue;
+        }
+        if (forced == NULL) {
+            active_kernel = &ascii_kernels[i];
+            return;
+        }
+        if (strcmp(forced, ascii_kernels[i].name) == 0) {
+            active_kernel = &ascii_kernels[i];
+            return;
+        }
+    }
+    if (forced != NULL) {
+        fprintf(stderr, "ASCII_KERNEL=%s is unknown or unsupported here, using scalar\n", forced);
+    }
+}
+
+const AsciiKernel *ascii_kernel_active(void) {
+    return active_kernel;
+}
+
+int collect_ascii_values(const char *line, size_t len) {
+    return active_kernel->max_span(line, len);
+}
+
+size_t collect_ascii_line(const char *text, size_t avail, int *max_value) {
+    return active_kernel->scan_line(text, avail, max_value);
+}
+
+void collect_line_stats(const char *line, size_t len, LineStats *stats) {
+    active_kernel->stats_span(line, len, stats);
+}
+
+void collect_utf8_stats(const char *line, size_t len, LineStats *stats) {
+    active_kernel->utf8_span(line, len, stats);
+}
+
+uint32_t collect_max_codepoint(const char *line, size_t len, int *invalid) {
+    LineStats stats;
+    active_kernel->utf8_span(line, len, &stats);
+    if (invalid) {
+        *invalid = stats.invalid;
+    }
+    return stats.codepoint;
+}
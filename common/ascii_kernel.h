@@ -0,0 +1,66 @@
+#ifndef ASCII_KERNEL_H
+#define ASCII_KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-line max-byte kernel shared by the pthread, OpenMP and MPI backends.
+//
+// The implementation is picked once at startup from what the CPU supports
+// (AVX-512BW, AVX2, SSE2, or a portable scalar loop). Setting the
+// ASCII_KERNEL environment variable to one of the variant names forces a
+// specific one, which is handy for benchmarking.
+
+// Max byte value of line[0..len), 0 for an empty line
+int collect_ascii_values(const char *line, size_t len);
+
+// Scan at most avail bytes of text for the end of the current line and
+// compute its max byte in the same pass. Returns the line length (the
+// index of the first '\n', or avail if there is none) and stores the max
+// of the bytes before it in *max_value.
+size_t collect_ascii_line(const char *text, size_t avail, int *max_value);
+
+// Everything the fused statistics kernel measures about one line
+typedef struct {
+    uint64_t length;     // Bytes, newline excluded
+    uint64_t non_ascii;  // Bytes above 127
+    uint8_t max;         // Largest byte, 0 for an empty line
+    uint8_t min;         // Smallest byte, 0 for an empty line
+    uint8_t control;     // 1 if the line holds a control byte (C0 other than tab, or DEL)
+    uint8_t invalid;     // 1 if not well-formed UTF-8 (collect_utf8_stats)
+    uint32_t codepoint;  // Largest codepoint (collect_utf8_stats)
+} LineStats;
+
+// All of LineStats for line[0..len) in a single pass over the bytes. Every
+// extra metric is a vector op or two next to the max, far cheaper than a
+// pass of its own.
+void collect_line_stats(const char *line, size_t len, LineStats *stats);
+
+// Largest Unicode codepoint of line[0..len) read as UTF-8, 0 for an empty
+// line. If invalid is not NULL it is set to 1 when the line is not
+// well-formed UTF-8; each ill-formed byte then counts as U+FFFD.
+// Pure-ASCII stretches are checked a vector at a time, so mostly-ASCII
+// text runs near the byte-max speed.
+uint32_t collect_max_codepoint(const char *line, size_t len, int *invalid);
+
+// The same pass filling the codepoint, invalid and max fields of stats
+void collect_utf8_stats(const char *line, size_t len, LineStats *stats);
+
+// One kernel implementation
+typedef struct {
+    const char *name;
+    int (*max_span)(const char *line, size_t len);
+    size_t (*scan_line)(const char *text, size_t avail, int *max_value);
+    int (*supported)(void);
+    void (*stats_span)(const char *line, size_t len, LineStats *stats);
+    void (*utf8_span)(const char *line, size_t len, LineStats *stats);
+} AsciiKernel;
+
+// All compiled-in variants, slowest first
+extern const AsciiKernel ascii_kernels[];
+extern const int ascii_kernel_count;
+
+// The variant the dispatched entry points above are using
+const AsciiKernel *ascii_kernel_active(void);
+
+#endif
@@ -0,0 +1,153 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "maxascii.h"
+#include "phase_timer_mpi.h"
+
+// One process per rank, each with a byte range of the file split on line
+// boundaries and num_threads pthreads inside it. Rank 0 writes every
+// rank's encoded results in rank order.
+
+#define MAX_IO_CHUNK (1 << 30)  // MPI counts are ints, so move data in 1GB pieces
+#define TAG_SLICES 1
+#define TAG_ROWS_LEN 2
+#define TAG_ROWS 3
+
+// Worker threads only compute; every MPI call stays on the main thread
+static int mpi_start(MaJob *job, int *argc, char ***argv) {
+    int provided;
+    MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &job->rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &job->num_procs);
+    return 0;
+}
+
+static int mpi_compute(MaJob *job) {
+    return ma_compute_pthreads(job);
+}
+
+// Global line numbering: an exclusive prefix sum of the per-rank counts
+static int mpi_number(MaJob *job) {
+    phase_begin(&job->timer, PHASE_PARTITION);
+    unsigned long long mine = job->input.num_lines;
+    unsigned long long before = 0;
+    unsigned long long total = 0;
+    MPI_Exscan(&mine, &before, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (job->rank == 0) {
+        before = 0;  // MPI_Exscan leaves rank 0's result undefined
+    }
+    MPI_Allreduce(&mine, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    job->first_line = before;
+    job->total_lines = total;
+    phase_end(&job->timer);
+    return 0;
+}
+
+// Ship one encoded slice to rank 0 in int-sized pieces
+static void send_rows(const char *text, size_t len) {
+    long long total = (long long)len;
+    MPI_Send(&total, 1, MPI_LONG_LONG, 0, TAG_ROWS_LEN, MPI_COMM_WORLD);
+    for (size_t done = 0; done < len; done += MAX_IO_CHUNK) {
+        int piece = (len - done > MAX_IO_CHUNK) ? MAX_IO_CHUNK : (int)(len - done);
+        MPI_Send(text + done, piece, MPI_CHAR, 0, TAG_ROWS, MPI_COMM_WORLD);
+    }
+}
+
+// On rank 0: receive one slice from source and write it straight to fd
+static int forward_rows(int source, int fd) {
+    long long total;
+    MPI_Recv(&total, 1, MPI_LONG_LONG, source, TAG_ROWS_LEN, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    if (total == 0) {
+        return 0;
+    }
+
+    size_t cap = (total > MAX_IO_CHUNK) ? MAX_IO_CHUNK : (size_t)total;
+    char *buf = malloc(cap);
+    if (buf == NULL) {
+        perror("Output buffer allocation failed");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int rc = 0;
+    for (long long done = 0; done < total; done += MAX_IO_CHUNK) {
+        int piece = (total - done > MAX_IO_CHUNK) ? MAX_IO_CHUNK : (int)(total - done);
+        MPI_Recv(buf, piece, MPI_CHAR, source, TAG_ROWS, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (rc == 0 && write_all(fd, buf, piece) != 0) {
+            rc = -1;  // Keep draining so the sender is not left blocked
+        }
+    }
+    free(buf);
+    return rc;
+}
+
+static int mpi_emit(MaJob *job, int fd) {
+    phase_begin(&job->timer, PHASE_GATHER);
+    struct iovec *iov = calloc(job->num_threads + 1, sizeof(struct iovec));
+    if (!iov || ma_encode_slices(job, iov) != 0) {
+        perror("Output buffer allocation failed");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (job->rank != 0) {
+        int slices = job->num_threads;
+        MPI_Send(&slices, 1, MPI_INT, 0, TAG_SLICES, MPI_COMM_WORLD);
+        for (int i = 0; i < slices; i++) {
+            send_rows(iov[i + 1].iov_base, iov[i + 1].iov_len);
+        }
+        ma_free_slices(job, iov);
+        free(iov);
+        phase_end(&job->timer);
+        return 0;
+    }
+
+    // Rank 0 writes the header and its own slices, then every other rank's
+    // in rank order
+    uint8_t header[RESULT_HEADER_SIZE];
+    encode_header(header, job->format, job->total_lines);
+    iov[0].iov_base = header;
+    iov[0].iov_len = (job->format == OUTPUT_TEXT) ? 0 : RESULT_HEADER_SIZE;
+    phase_begin(&job->timer, PHASE_OUTPUT);
+    int rc = writev_all(fd, iov, job->num_threads + 1);
+    ma_free_slices(job, iov);
+    free(iov);
+
+    for (int r = 1; r < job->num_procs; r++) {
+        int slices;
+        MPI_Recv(&slices, 1, MPI_INT, r, TAG_SLICES, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        for (int i = 0; i < slices; i++) {
+            if (forward_rows(r, fd) != 0) {
+                rc = -1;
+            }
+        }
+    }
+    phase_end(&job->timer);
+    if (rc != 0) {
+        perror("Error writing results");
+    }
+    return rc;
+}
+
+static void mpi_combine_timers(MaJob *job) {
+    phase_timer_reduce(&job->timer, MPI_COMM_WORLD);
+}
+
+static void mpi_stop(MaJob *job) {
+    (void)job;
+    MPI_Finalize();
+}
+
+static void mpi_abort(MaJob *job) {
+    (void)job;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+}
+
+const MaBackend ma_backend_mpi = {
+    .name = "mpi",
+    .start = mpi_start,
+    .compute = mpi_compute,
+    .number = mpi_number,
+    .emit = mpi_emit,
+    .stop = mpi_stop,
+    .abort = mpi_abort,
+    .combine_timers = mpi_combine_timers,
+};
@@ -0,0 +1,39 @@
+#include <omp.h>
+
+#include "maxascii.h"
+
+#define CHUNK_SIZE 256  // Lines per dynamically scheduled chunk
+
+// OpenMP worksharing loop; dynamic scheduling absorbs skewed line lengths
+
+static int openmp_start(MaJob *job, int *argc, char ***argv) {
+    (void)argc;
+    (void)argv;
+    omp_set_num_threads(job->num_threads);
+    return 0;
+}
+
+static int openmp_compute(MaJob *job) {
+    long long n = (long long)job->input.num_lines;
+
+    // The runtime hands out the chunks, so there is no partition phase
+    phase_begin(&job->timer, PHASE_COMPUTE);
+    #pragma omp parallel
+    {
+        cpu_placement_pin_self(&job->placement, omp_get_thread_num());
+        phase_thread_enter(&job->timer);
+        #pragma omp for schedule(dynamic, CHUNK_SIZE)
+        for (long long i = 0; i < n; i++) {
+            ma_measure_line(job, (size_t)i);
+        }
+        phase_thread_leave(&job->timer, PHASE_COMPUTE);
+    }
+    phase_end(&job->timer);
+    return 0;
+}
+
+const MaBackend ma_backend_openmp = {
+    .name = "openmp",
+    .start = openmp_start,
+    .compute = openmp_compute,
+};
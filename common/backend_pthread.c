@@ -0,0 +1,12 @@
+#include "maxascii.h"
+
+// Plain pthreads with work-stealing over blocks of lines
+
+static int pthread_compute(MaJob *job) {
+    return ma_compute_pthreads(job);
+}
+
+const MaBackend ma_backend_pthread = {
+    .name = "pthread",
+    .compute = pthread_compute,
+};
@@ -0,0 +1,24 @@
+#include <string.h>
+
+#include "maxascii.h"
+
+// Backend registry. Kept out of maxascii.c so that programs using only
+// the core helpers do not drag in the OpenMP or MPI runtimes.
+
+const MaBackend *const ma_backends[] = {
+    &ma_backend_pthread,
+    &ma_backend_openmp,
+#ifdef MAXASCII_WITH_MPI
+    &ma_backend_mpi,
+#endif
+    NULL
+};
+
+const MaBackend *ma_find_backend(const char *name) {
+    for (int i = 0; ma_backends[i]; i++) {
+        if (strcmp(ma_backends[i]->name, name) == 0) {
+            return ma_backends[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,128 @@
+#include "byte_histogram.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes counted into the 32-bit lanes before they are folded into the
+// 64-bit totals; a lane sees at most a quarter of them
+#define HISTOGRAM_CHUNK ((size_t)1 << 30)
+
+static void count_chunk(const uint8_t *p, size_t len, uint32_t lanes[HISTOGRAM_LANES][HISTOGRAM_BINS]) {
+    size_t i = 0;
+    // One 8-byte load, each byte to the next lane in turn
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        lanes[0][w & 0xff]++;
+        lanes[1][(w >> 8) & 0xff]++;
+        lanes[2][(w >> 16) & 0xff]++;
+        lanes[3][(w >> 24) & 0xff]++;
+        lanes[0][(w >> 32) & 0xff]++;
+        lanes[1][(w >> 40) & 0xff]++;
+        lanes[2][(w >> 48) & 0xff]++;
+        lanes[3][w >> 56]++;
+    }
+    for (; i < len; i++) {
+        lanes[i % HISTOGRAM_LANES][p[i]]++;
+    }
+}
+
+void byte_histogram_count(const uint8_t *data, size_t len, uint64_t counts[HISTOGRAM_BINS]) {
+    uint32_t lanes[HISTOGRAM_LANES][HISTOGRAM_BINS];
+    while (len > 0) {
+        size_t n = len < HISTOGRAM_CHUNK ? len : HISTOGRAM_CHUNK;
+        memset(lanes, 0, sizeof(lanes));
+        count_chunk(data, n, lanes);
+        for (int b = 0; b < HISTOGRAM_BINS; b++) {
+            counts[b] += (uint64_t)lanes[0][b] + lanes[1][b] + lanes[2][b] + lanes[3][b];
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+// 2 KB, a whole number of cache lines, and line-aligned
+typedef struct {
+    _Alignas(64) uint64_t counts[HISTOGRAM_BINS];
+} ThreadHistogram;
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    int num_threads;
+    const CpuPlacement *placement;
+    ThreadHistogram *tables;
+    pthread_barrier_t level_done;
+} HistogramJob;
+
+typedef struct {
+    HistogramJob *job;
+    int id;
+} HistogramArgs;
+
+static void *histogram_thread(void *arg) {
+    HistogramArgs *a = (HistogramArgs *)arg;
+    HistogramJob *job = a->job;
+    int id = a->id;
+    int n = job->num_threads;
+    if (job->placement) {
+        cpu_placement_pin_self(job->placement, id);
+    }
+
+    size_t first = job->size * id / n;
+    size_t last = job->size * (id + 1) / n;
+    uint64_t *mine = job->tables[id].counts;
+    memset(mine, 0, sizeof(job->tables[id].counts));
+    byte_histogram_count(job->data + first, last - first, mine);
+
+    // Pairwise tree merge: after the round with a given step, thread i
+    // (a multiple of 2 * step) holds the sum of threads i..i + 2 * step - 1
+    for (int step = 1; step < n; step *= 2) {
+        pthread_barrier_wait(&job->level_done);
+        if (id % (2 * step) == 0 && id + step < n) {
+            const uint64_t *other = job->tables[id + step].counts;
+            for (int b = 0; b < HISTOGRAM_BINS; b++) {
+                mine[b] += other[b];
+            }
+        }
+    }
+    return NULL;
+}
+
+int byte_histogram_parallel(const uint8_t *data, size_t size, int num_threads,
+                            const CpuPlacement *placement, uint64_t counts[HISTOGRAM_BINS]) {
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    HistogramJob job = {.data = data, .size = size, .num_threads = num_threads,
+                        .placement = placement};
+    job.tables = aligned_alloc(64, num_threads * sizeof(ThreadHistogram));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    HistogramArgs *args = malloc(num_threads * sizeof(HistogramArgs));
+    if (!job.tables || !threads || !args) {
+        perror("Histogram allocation failed");
+        free(job.tables);
+        free(threads);
+        free(args);
+        return -1;
+    }
+    pthread_barrier_init(&job.level_done, NULL, num_threads);
+
+    for (int i = 0; i < num_threads; i++) {
+        args[i].job = &job;
+        args[i].id = i;
+        pthread_create(&threads[i], NULL, histogram_thread, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    memcpy(counts, job.tables[0].counts, sizeof(job.tables[0].counts));
+
+    pthread_barrier_destroy(&job.level_done);
+    free(job.tables);
+    free(threads);
+    free(args);
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef BYTE_HISTOGRAM_H
+#define BYTE_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "affinity.h"
+
+// 256-bin byte histogram (character-frequency profile) of a buffer, meant
+// to run at memory bandwidth.
+//
+// A single table stalls whenever neighbouring bytes hit the same bin: each
+// increment has to wait for the previous store to the same counter. The
+// counting loop therefore spreads consecutive bytes over
+// HISTOGRAM_LANES interleaved sub-tables and folds them at the end.
+//
+// In parallel, every thread owns a table aligned to cache lines, so no two
+// threads ever write the same line, and the tables are combined pairwise
+// in log2(threads) rounds (thread i takes in thread i + step) instead of
+// through a lock.
+
+#define HISTOGRAM_BINS 256
+#define HISTOGRAM_LANES 4
+
+// Add the byte counts of data[0..len) to counts
+void byte_histogram_count(const uint8_t *data, size_t len, uint64_t counts[HISTOGRAM_BINS]);
+
+// Histogram of data[0..size) with num_threads threads, worker i pinned to
+// placement slot i (placement may be NULL). Overwrites counts. Returns 0
+// or -1.
+int byte_histogram_parallel(const uint8_t *data, size_t size, int num_threads,
+                            const CpuPlacement *placement, uint64_t counts[HISTOGRAM_BINS]);
+
+#endif
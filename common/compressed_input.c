@@ -0,0 +1,435 @@
+#include "compressed_input.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef MAXASCII_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#define ZSTD_MAGIC 0xfd2fb528u
+
+// zlib counts in uInt, so feed and drain it at most this much at a time
+#define ZLIB_STEP ((size_t)UINT_MAX)
+
+static uint32_t le32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+Compression compression_detect(const void *data, size_t size) {
+    const unsigned char *p = data;
+    if (size >= 2 && p[0] == 0x1f && p[1] == 0x8b) {
+        return COMPRESSION_GZIP;
+    }
+    if (size >= 4 && le32(p) == ZSTD_MAGIC) {
+        return COMPRESSION_ZSTD;
+    }
+    return COMPRESSION_NONE;
+}
+
+Compression compression_of_file(const char *filename) {
+    unsigned char magic[4];
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return COMPRESSION_NONE;  // The caller's own open reports the error
+    }
+    ssize_t got = read(fd, magic, sizeof(magic));
+    close(fd);
+    return compression_detect(magic, got > 0 ? (size_t)got : 0);
+}
+
+const char *compression_name(Compression kind) {
+    switch (kind) {
+    case COMPRESSION_GZIP:
+        return "gzip";
+    case COMPRESSION_ZSTD:
+        return "zstd";
+    default:
+        return "none";
+    }
+}
+
+static int add_block(CompressedInput *input, size_t *capacity, size_t in_offset, size_t in_size,
+                     size_t out_size) {
+    if (out_size == 0) {
+        return 0;  // End-of-file markers and skippable frames hold no text
+    }
+    if (input->num_blocks == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 1024;
+        CompressedBlock *grown = realloc(input->blocks, *capacity * sizeof(CompressedBlock));
+        if (!grown) {
+            perror("Block list allocation failed");
+            return -1;
+        }
+        input->blocks = grown;
+    }
+    CompressedBlock *b = &input->blocks[input->num_blocks++];
+    b->in_offset = in_offset;
+    b->in_size = in_size;
+    b->out_offset = input->text_size;
+    b->out_size = out_size;
+    input->text_size += out_size;
+    return 0;
+}
+
+// Total size of the BGZF member at p: a gzip member whose FEXTRA field
+// holds subfield "BC" of length 2, the member size minus one. 0 if p does
+// not start a BGZF member.
+static size_t bgzf_member_size(const unsigned char *p, size_t avail) {
+    if (avail < 18 || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || !(p[3] & 4)) {
+        return 0;
+    }
+    size_t xlen = p[10] | (size_t)p[11] << 8;
+    if (12 + xlen > avail) {
+        return 0;
+    }
+    size_t i = 12;
+    while (i + 4 <= 12 + xlen) {
+        size_t slen = p[i + 2] | (size_t)p[i + 3] << 8;
+        if (p[i] == 'B' && p[i + 1] == 'C' && slen == 2 && i + 6 <= 12 + xlen) {
+            size_t size = (p[i + 4] | (size_t)p[i + 5] << 8) + 1;
+            return (size >= 12 + xlen + 8 && size <= avail) ? size : 0;
+        }
+        i += 4 + slen;
+    }
+    return 0;
+}
+
+// A BGZF file is nothing but BGZF members; the last 4 bytes of each give
+// its uncompressed size. Anything else leaves blocks NULL.
+static int walk_bgzf(CompressedInput *input) {
+    size_t capacity = 0;
+    size_t pos = 0;
+    while (pos < input->size) {
+        size_t member = bgzf_member_size(input->data + pos, input->size - pos);
+        if (member == 0) {
+            free(input->blocks);
+            input->blocks = NULL;
+            input->num_blocks = 0;
+            input->text_size = 0;
+            return 0;
+        }
+        if (add_block(input, &capacity, pos, member, le32(input->data + pos + member - 4)) != 0) {
+            return -1;
+        }
+        pos += member;
+    }
+    return 0;
+}
+
+#ifdef MAXASCII_WITH_ZSTD
+// Frames that record their content size are blocks; a single frame
+// without one (plain streaming output) means no block list
+static int walk_zstd(CompressedInput *input) {
+    size_t capacity = 0;
+    size_t pos = 0;
+    while (pos < input->size) {
+        const unsigned char *p = input->data + pos;
+        size_t frame = ZSTD_findFrameCompressedSize(p, input->size - pos);
+        if (ZSTD_isError(frame)) {
+            fprintf(stderr, "Error: damaged zstd frame at byte %zu: %s\n", pos,
+                    ZSTD_getErrorName(frame));
+            return -1;
+        }
+        unsigned long long content = ZSTD_getFrameContentSize(p, frame);
+        if (content == ZSTD_CONTENTSIZE_UNKNOWN || content == ZSTD_CONTENTSIZE_ERROR) {
+            free(input->blocks);
+            input->blocks = NULL;
+            input->num_blocks = 0;
+            input->text_size = 0;
+            return 0;
+        }
+        if (add_block(input, &capacity, pos, frame, (size_t)content) != 0) {
+            return -1;
+        }
+        pos += frame;
+    }
+    return 0;
+}
+#endif
+
+int compressed_input_open(CompressedInput *input, const void *data, size_t size) {
+    memset(input, 0, sizeof(*input));
+    input->kind = compression_detect(data, size);
+    input->data = data;
+    input->size = size;
+    switch (input->kind) {
+    case COMPRESSION_GZIP:
+        return walk_bgzf(input);
+    case COMPRESSION_ZSTD:
+#ifdef MAXASCII_WITH_ZSTD
+        return walk_zstd(input);
+#else
+        fprintf(stderr, "Error: zstd input needs a build with zstd support (make ZSTD=1)\n");
+        return -1;
+#endif
+    default:
+        fprintf(stderr, "Error: input is not gzip or zstd compressed\n");
+        return -1;
+    }
+}
+
+size_t compressed_input_find(const CompressedInput *input, size_t pos) {
+    if (pos >= input->text_size) {
+        return input->num_blocks;
+    }
+    // Last block starting at or before pos; blocks tile the text
+    size_t lo = 0, hi = input->num_blocks;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (input->blocks[mid].out_offset <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+typedef struct {
+    const CompressedInput *input;
+    size_t first;
+    size_t last;
+    char *out;        // Where blocks[first] lands
+    size_t base;      // blocks[first].out_offset of the whole request
+    int failed;
+} BlockWork;
+
+static void *inflate_blocks(void *arg) {
+    BlockWork *w = (BlockWork *)arg;
+    const CompressedInput *input = w->input;
+    if (w->first == w->last) {
+        return NULL;
+    }
+#ifdef MAXASCII_WITH_ZSTD
+    if (input->kind == COMPRESSION_ZSTD) {
+        ZSTD_DCtx *dctx = ZSTD_createDCtx();
+        if (!dctx) {
+            w->failed = 1;
+            return NULL;
+        }
+        for (size_t i = w->first; i < w->last && !w->failed; i++) {
+            const CompressedBlock *b = &input->blocks[i];
+            size_t got = ZSTD_decompressDCtx(dctx, w->out + (b->out_offset - w->base), b->out_size,
+                                             input->data + b->in_offset, b->in_size);
+            w->failed = ZSTD_isError(got) || got != b->out_size;
+        }
+        ZSTD_freeDCtx(dctx);
+        return NULL;
+    }
+#endif
+    // BGZF members are at most 64KB each way, well inside zlib's uInt
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        w->failed = 1;
+        return NULL;
+    }
+    for (size_t i = w->first; i < w->last && !w->failed; i++) {
+        const CompressedBlock *b = &input->blocks[i];
+        inflateReset(&zs);
+        zs.next_in = (unsigned char *)input->data + b->in_offset;
+        zs.avail_in = (uInt)b->in_size;
+        zs.next_out = (unsigned char *)w->out + (b->out_offset - w->base);
+        zs.avail_out = (uInt)b->out_size;
+        w->failed = inflate(&zs, Z_FINISH) != Z_STREAM_END || zs.total_out != b->out_size;
+    }
+    inflateEnd(&zs);
+    return NULL;
+}
+
+int compressed_input_blocks(const CompressedInput *input, size_t first, size_t last,
+                            int num_threads, char *out) {
+    size_t n = last - first;
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if ((size_t)num_threads > n) {
+        num_threads = n ? (int)n : 1;
+    }
+    BlockWork *work = calloc(num_threads, sizeof(BlockWork));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!work || !threads) {
+        perror("Decompression allocation failed");
+        free(work);
+        free(threads);
+        return -1;
+    }
+
+    // Blocks are all about the same size, so equal contiguous runs balance
+    size_t base = n ? input->blocks[first].out_offset : 0;
+    for (int t = 0; t < num_threads; t++) {
+        work[t].input = input;
+        work[t].first = first + n * t / num_threads;
+        work[t].last = first + n * (t + 1) / num_threads;
+        work[t].out = out;
+        work[t].base = base;
+        if (t > 0) {
+            pthread_create(&threads[t], NULL, inflate_blocks, &work[t]);
+        }
+    }
+    inflate_blocks(&work[0]);
+    int failed = work[0].failed;
+    for (int t = 1; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+        failed |= work[t].failed;
+    }
+    free(work);
+    free(threads);
+    if (failed) {
+        fprintf(stderr, "Error: corrupt %s block\n", compression_name(input->kind));
+        return -1;
+    }
+    return 0;
+}
+
+static int grow_text(char **text, size_t *capacity) {
+    char *grown = realloc(*text, *capacity * 2);
+    if (!grown) {
+        perror("Decompression buffer allocation failed");
+        return -1;
+    }
+    *text = grown;
+    *capacity *= 2;
+    return 0;
+}
+
+// One gzip stream of any number of members, front to back
+static int gunzip_serial(const CompressedInput *input, char **text, size_t *text_size) {
+    size_t capacity = input->size * 4 + 65536;
+    char *buf = malloc(capacity);
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (!buf || inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        perror("Decompression allocation failed");
+        free(buf);
+        return -1;
+    }
+
+    size_t pos = 0, len = 0;
+    int rc = 0;
+    for (;;) {
+        if (len == capacity && grow_text(&buf, &capacity) != 0) {
+            rc = -1;
+            break;
+        }
+        zs.next_in = (unsigned char *)input->data + pos;
+        zs.avail_in = (uInt)(input->size - pos < ZLIB_STEP ? input->size - pos : ZLIB_STEP);
+        zs.next_out = (unsigned char *)buf + len;
+        zs.avail_out = (uInt)(capacity - len < ZLIB_STEP ? capacity - len : ZLIB_STEP);
+        int z = inflate(&zs, Z_NO_FLUSH);
+        pos = (size_t)(zs.next_in - input->data);
+        len = (size_t)((char *)zs.next_out - buf);
+        if (z == Z_STREAM_END) {
+            if (pos == input->size) {
+                break;
+            }
+            // Concatenated members (cat a.gz b.gz) decompress to a + b
+            if (compression_detect(input->data + pos, input->size - pos) != COMPRESSION_GZIP) {
+                fprintf(stderr, "Error: trailing garbage after gzip data\n");
+                rc = -1;
+                break;
+            }
+            inflateReset(&zs);
+        } else if (z == Z_BUF_ERROR && pos == input->size && len < capacity) {
+            fprintf(stderr, "Error: gzip data is truncated\n");
+            rc = -1;
+            break;
+        } else if (z != Z_OK && z != Z_BUF_ERROR) {
+            fprintf(stderr, "Error: corrupt gzip data: %s\n", zs.msg ? zs.msg : "unknown error");
+            rc = -1;
+            break;
+        }
+    }
+    inflateEnd(&zs);
+    if (rc != 0) {
+        free(buf);
+        return -1;
+    }
+    *text = buf;
+    *text_size = len;
+    return 0;
+}
+
+#ifdef MAXASCII_WITH_ZSTD
+// Frames without a recorded size, front to back
+static int unzstd_serial(const CompressedInput *input, char **text, size_t *text_size) {
+    size_t capacity = input->size * 4 + 65536;
+    char *buf = malloc(capacity);
+    ZSTD_DStream *ds = ZSTD_createDStream();
+    if (!buf || !ds) {
+        perror("Decompression allocation failed");
+        free(buf);
+        ZSTD_freeDStream(ds);
+        return -1;
+    }
+
+    ZSTD_inBuffer in = {input->data, input->size, 0};
+    size_t len = 0;
+    int rc = 0;
+    for (;;) {
+        if (len == capacity && grow_text(&buf, &capacity) != 0) {
+            rc = -1;
+            break;
+        }
+        ZSTD_outBuffer out = {buf, capacity, len};
+        size_t left = ZSTD_decompressStream(ds, &out, &in);
+        len = out.pos;
+        if (ZSTD_isError(left)) {
+            fprintf(stderr, "Error: corrupt zstd data: %s\n", ZSTD_getErrorName(left));
+            rc = -1;
+            break;
+        }
+        if (in.pos == in.size && len < capacity) {
+            if (left != 0) {
+                fprintf(stderr, "Error: zstd data is truncated\n");
+                rc = -1;
+            }
+            break;
+        }
+    }
+    ZSTD_freeDStream(ds);
+    if (rc != 0) {
+        free(buf);
+        return -1;
+    }
+    *text = buf;
+    *text_size = len;
+    return 0;
+}
+#endif
+
+int compressed_input_all(const CompressedInput *input, int num_threads, char **text,
+                         size_t *text_size) {
+    if (!input->blocks) {
+#ifdef MAXASCII_WITH_ZSTD
+        if (input->kind == COMPRESSION_ZSTD) {
+            return unzstd_serial(input, text, text_size);
+        }
+#endif
+        return gunzip_serial(input, text, text_size);
+    }
+    char *buf = malloc(input->text_size ? input->text_size : 1);
+    if (!buf) {
+        perror("Decompression buffer allocation failed");
+        return -1;
+    }
+    if (compressed_input_blocks(input, 0, input->num_blocks, num_threads, buf) != 0) {
+        free(buf);
+        return -1;
+    }
+    *text = buf;
+    *text_size = input->text_size;
+    return 0;
+}
+
+void compressed_input_close(CompressedInput *input) {
+    free(input->blocks);
+    memset(input, 0, sizeof(*input));
+}
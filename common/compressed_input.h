@@ -0,0 +1,67 @@
+#ifndef COMPRESSED_INPUT_H
+#define COMPRESSED_INPUT_H
+
+#include <stddef.h>
+
+// gzip and zstd inputs, decompressed in memory rather than to disk first.
+// zstd needs the library: build with make ZSTD=1.
+//
+// Block-framed streams decompress in parallel. That means BGZF (bgzip:
+// a chain of small gzip members, each recording its own compressed and
+// uncompressed size) and zstd streams made of several frames that record
+// their content size (zstd -T / pzstd output, the seekable format).
+// Walking the headers places every block in the output up front. Workers
+// then decompress whole blocks straight into the final buffer, and a view
+// of part of the text decompresses only the blocks it covers. Any other
+// gzip or zstd stream is decompressed front to back by one thread.
+
+typedef enum {
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD
+} Compression;
+
+// One independently decompressible block: compressed bytes
+// [in_offset, in_offset + in_size) hold text [out_offset, out_offset + out_size)
+typedef struct {
+    size_t in_offset;
+    size_t in_size;
+    size_t out_offset;
+    size_t out_size;
+} CompressedBlock;
+
+typedef struct {
+    Compression kind;
+    const unsigned char *data;
+    size_t size;
+    CompressedBlock *blocks;  // Non-empty blocks in order; NULL if not block-framed
+    size_t num_blocks;
+    size_t text_size;         // Decompressed size, known only when blocks is set
+} CompressedInput;
+
+// Format of a buffer or file from its magic bytes
+Compression compression_detect(const void *data, size_t size);
+Compression compression_of_file(const char *filename);
+const char *compression_name(Compression kind);
+
+// Walk the frame headers of data[0..size), which must stay valid until
+// compressed_input_close. Returns 0, or -1 if the format is not built in or
+// the headers are damaged (reported on stderr).
+int compressed_input_open(CompressedInput *input, const void *data, size_t size);
+
+// Index of the block holding text byte pos, or num_blocks past the end
+size_t compressed_input_find(const CompressedInput *input, size_t pos);
+
+// Decompress blocks [first, last) into out, which has room for the text
+// from blocks[first].out_offset to the end of block last - 1, using up to
+// num_threads threads. Returns 0 or -1.
+int compressed_input_blocks(const CompressedInput *input, size_t first, size_t last,
+                            int num_threads, char *out);
+
+// Decompress the whole stream into a new malloc'd buffer. Returns 0 or -1.
+int compressed_input_all(const CompressedInput *input, int num_threads, char **text,
+                         size_t *text_size);
+
+void compressed_input_close(CompressedInput *input);
+
+#endif
@@ -0,0 +1,99 @@
+#include "line_arena.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define INITIAL_BYTES (1 << 20)   // First text buffer, grown by doubling
+#define INITIAL_SPANS 65536       // First index size, grown by doubling
+#define READ_CHUNK (1 << 20)      // Bytes asked of each read()
+
+void line_arena_init(LineArena *arena) {
+    memset(arena, 0, sizeof(*arena));
+}
+
+static int push_span(LineArena *arena, size_t offset, size_t length) {
+    if (arena->num_lines == arena->span_capacity) {
+        size_t capacity = arena->span_capacity ? arena->span_capacity * 2 : INITIAL_SPANS;
+        LineSpan *grown = realloc(arena->spans, capacity * sizeof(LineSpan));
+        if (!grown) {
+            perror("Line index allocation failed");
+            return -1;
+        }
+        arena->spans = grown;
+        arena->span_capacity = capacity;
+    }
+    arena->spans[arena->num_lines].offset = offset;
+    arena->spans[arena->num_lines].length = length;
+    arena->num_lines++;
+    return 0;
+}
+
+// Record every line completed by the bytes in [from, size). Only the new
+// bytes are scanned, so the index costs one pass over the input overall.
+static int index_new_bytes(LineArena *arena, size_t from) {
+    const char *p = arena->data + from;
+    const char *end = arena->data + arena->size;
+    const char *nl;
+    while (p < end && (nl = memchr(p, '\n', end - p)) != NULL) {
+        size_t stop = (size_t)(nl - arena->data);
+        if (push_span(arena, arena->line_start, stop - arena->line_start) != 0) {
+            return -1;
+        }
+        arena->line_start = stop + 1;
+        p = nl + 1;
+    }
+    return 0;
+}
+
+int line_arena_read_fd(LineArena *arena, int fd) {
+    for (;;) {
+        if (arena->capacity - arena->size < READ_CHUNK) {
+            size_t capacity = arena->capacity ? arena->capacity * 2 : INITIAL_BYTES;
+            while (capacity - arena->size < READ_CHUNK) {
+                capacity *= 2;
+            }
+            char *grown = realloc(arena->data, capacity);
+            if (!grown) {
+                perror("Input buffer allocation failed");
+                return -1;
+            }
+            arena->data = grown;
+            arena->capacity = capacity;
+        }
+
+        ssize_t got = read(fd, arena->data + arena->size, arena->capacity - arena->size);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error reading input");
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        size_t from = arena->size;
+        arena->size += (size_t)got;
+        if (index_new_bytes(arena, from) != 0) {
+            return -1;
+        }
+    }
+
+    // A final line without a newline still counts
+    if (arena->line_start < arena->size) {
+        if (push_span(arena, arena->line_start, arena->size - arena->line_start) != 0) {
+            return -1;
+        }
+        arena->line_start = arena->size;
+    }
+    return 0;
+}
+
+void line_arena_free(LineArena *arena) {
+    free(arena->data);
+    free(arena->spans);
+    line_arena_init(arena);
+}
@@ -0,0 +1,32 @@
+#ifndef LINE_ARENA_H
+#define LINE_ARENA_H
+
+#include <stddef.h>
+
+#include "mapped_input.h"
+
+// Growable storage for inputs that cannot be mapped (pipes, stdin,
+// terminals). All line bytes live back to back in one buffer, newlines
+// included, and spans index into it exactly like a MappedInput, so there
+// is one allocation for the text and one for the index whatever the line
+// count or length.
+typedef struct {
+    char *data;           // Every byte read, in order
+    size_t size;
+    size_t capacity;
+    LineSpan *spans;      // One span per complete line
+    size_t num_lines;
+    size_t span_capacity;
+    size_t line_start;    // Offset of the line still being read
+} LineArena;
+
+void line_arena_init(LineArena *arena);
+
+// Read fd to end of file, indexing lines as the bytes arrive. Returns 0,
+// or -1 on a read or allocation error (reported with perror).
+int line_arena_read_fd(LineArena *arena, int fd);
+
+// Release the text and the index
+void line_arena_free(LineArena *arena);
+
+#endif
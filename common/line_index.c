@@ -0,0 +1,260 @@
+#include "line_index.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_input.h"
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t file_size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t num_lines;
+    uint64_t last_end;
+} IndexHeader;
+
+char *line_index_path(const char *input_path) {
+    size_t len = strlen(input_path) + sizeof(LINE_INDEX_SUFFIX);
+    char *path = malloc(len);
+    if (!path) {
+        perror("Index path allocation failed");
+        return NULL;
+    }
+    snprintf(path, len, "%s%s", input_path, LINE_INDEX_SUFFIX);
+    return path;
+}
+
+int line_index_open(LineIndex *index, const char *input_path) {
+    memset(index, 0, sizeof(*index));
+    struct stat in_st;
+    if (stat(input_path, &in_st) != 0) {
+        return 1;
+    }
+    char *path = line_index_path(input_path);
+    if (!path) {
+        return -1;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        free(path);
+        return 1;
+    }
+
+    // Anything that does not describe the input as it is now is stale
+    struct stat st;
+    IndexHeader header;
+    int valid = fstat(fd, &st) == 0 &&
+                pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                memcmp(header.magic, LINE_INDEX_MAGIC, 4) == 0 &&
+                header.version == LINE_INDEX_VERSION &&
+                header.file_size == (uint64_t)in_st.st_size &&
+                header.mtime_sec == (int64_t)in_st.st_mtim.tv_sec &&
+                header.mtime_nsec == (int64_t)in_st.st_mtim.tv_nsec &&
+                (uint64_t)st.st_size == sizeof(header) + header.num_lines * sizeof(uint64_t);
+    if (!valid) {
+        fprintf(stderr, "Ignoring stale line index %s\n", path);
+        close(fd);
+        free(path);
+        return 1;
+    }
+    free(path);
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error mapping line index");
+        return -1;
+    }
+    index->num_lines = header.num_lines;
+    index->file_size = header.file_size;
+    index->last_end = header.last_end;
+    index->starts = (const uint64_t *)((const char *)map + sizeof(header));
+    index->map = map;
+    index->map_size = (size_t)st.st_size;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Parallel build
+// ---------------------------------------------------------------------------
+
+// Each thread owns a byte range and the line starts inside it: every start
+// but the first follows a newline, so a thread counts the newlines in its
+// range, and after a prefix sum over the counts writes their successors
+typedef struct {
+    const char *data;
+    size_t size;
+    size_t lo;
+    size_t hi;
+    uint64_t count;
+    uint64_t *out;     // Where this thread's starts go (second pass)
+} IndexPiece;
+
+static void *count_starts(void *arg) {
+    IndexPiece *p = (IndexPiece *)arg;
+    uint64_t count = (p->lo == 0 && p->size > 0);
+    const char *at = p->data + p->lo;
+    const char *end = p->data + p->hi;
+    while (at < end && (at = memchr(at, '\n', end - at)) != NULL) {
+        if ((size_t)(at - p->data) + 1 < p->size) {
+            count++;
+        }
+        at++;
+    }
+    p->count = count;
+    return NULL;
+}
+
+static void *write_starts(void *arg) {
+    IndexPiece *p = (IndexPiece *)arg;
+    uint64_t *out = p->out;
+    if (p->lo == 0 && p->size > 0) {
+        *out++ = 0;
+    }
+    const char *at = p->data + p->lo;
+    const char *end = p->data + p->hi;
+    while (at < end && (at = memchr(at, '\n', end - at)) != NULL) {
+        size_t next = (size_t)(at - p->data) + 1;
+        if (next < p->size) {
+            *out++ = next;
+        }
+        at++;
+    }
+    return NULL;
+}
+
+static void run_pieces(IndexPiece *pieces, int n, void *(*fn)(void *)) {
+    pthread_t *threads = malloc(n * sizeof(pthread_t));
+    if (!threads) {
+        for (int i = 0; i < n; i++) {
+            fn(&pieces[i]);  // Degrade to one thread rather than fail
+        }
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        pthread_create(&threads[i], NULL, fn, &pieces[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
+
+int line_index_build(const char *input_path, int num_threads) {
+    MappedInput input;
+    if (mapped_input_map(&input, input_path) != 0) {
+        return -1;
+    }
+    struct stat in_st;
+    if (fstat(input.fd, &in_st) != 0) {
+        perror("Error reading file size");
+        mapped_input_close(&input);
+        return -1;
+    }
+
+    IndexPiece *pieces = calloc(num_threads, sizeof(IndexPiece));
+    if (!pieces) {
+        perror("Index allocation failed");
+        mapped_input_close(&input);
+        return -1;
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pieces[i].data = input.data;
+        pieces[i].size = input.size;
+        pieces[i].lo = input.size * i / num_threads;
+        pieces[i].hi = input.size * (i + 1) / num_threads;
+    }
+    run_pieces(pieces, num_threads, count_starts);
+
+    uint64_t total = 0;
+    for (int i = 0; i < num_threads; i++) {
+        total += pieces[i].count;
+    }
+    uint64_t *starts = malloc((total ? total : 1) * sizeof(uint64_t));
+    if (!starts) {
+        perror("Index allocation failed");
+        free(pieces);
+        mapped_input_close(&input);
+        return -1;
+    }
+    uint64_t at = 0;
+    for (int i = 0; i < num_threads; i++) {
+        pieces[i].out = starts + at;
+        at += pieces[i].count;
+    }
+    run_pieces(pieces, num_threads, write_starts);
+    free(pieces);
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LINE_INDEX_MAGIC, 4);
+    header.version = LINE_INDEX_VERSION;
+    header.file_size = input.size;
+    header.mtime_sec = (int64_t)in_st.st_mtim.tv_sec;
+    header.mtime_nsec = (int64_t)in_st.st_mtim.tv_nsec;
+    header.num_lines = total;
+    header.last_end = input.size;
+    if (input.size > 0 && input.data[input.size - 1] == '\n') {
+        header.last_end--;
+    }
+    mapped_input_close(&input);
+
+    char *path = line_index_path(input_path);
+    char *tmp = path ? malloc(strlen(path) + 5) : NULL;
+    if (!tmp) {
+        free(path);
+        free(starts);
+        return -1;
+    }
+    sprintf(tmp, "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    int ok = f != NULL &&
+             fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(starts, sizeof(uint64_t), total, f) == total;
+    if (f && fclose(f) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(tmp, path) != 0) {
+        perror("Error writing line index");
+        remove(tmp);
+        ok = 0;
+    }
+    free(tmp);
+    free(path);
+    free(starts);
+    return ok ? 0 : -1;
+}
+
+uint64_t line_index_find(const LineIndex *index, uint64_t pos) {
+    uint64_t lo = 0;
+    uint64_t hi = index->num_lines;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (index->starts[mid] < pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void line_index_line(const LineIndex *index, uint64_t n, uint64_t *begin, uint64_t *end) {
+    *begin = index->starts[n];
+    *end = (n + 1 < index->num_lines) ? index->starts[n + 1] - 1 : index->last_end;
+}
+
+void line_index_close(LineIndex *index) {
+    if (index->map) {
+        munmap(index->map, index->map_size);
+    }
+    memset(index, 0, sizeof(*index));
+}
@@ -0,0 +1,54 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Persistent line-offset index: a companion file "<input>.idx" holding the
+// byte offset of every line start, so partitioning, line-range jobs and
+// random access to line N need no scan of the text.
+//
+// The index is only trusted while the input's size and modification time
+// match the ones recorded when it was built; anything else reads as stale.
+//
+// File layout (host byte order; the index is a local artefact):
+//   header   magic "MAXI", uint32 version, uint64 file size,
+//            int64 mtime seconds, int64 mtime nanoseconds,
+//            uint64 line count, uint64 end of the last line (newline
+//            excluded)
+//   starts   uint64 offset of each line start, ascending
+
+#define LINE_INDEX_MAGIC "MAXI"
+#define LINE_INDEX_VERSION 1
+#define LINE_INDEX_SUFFIX ".idx"
+
+typedef struct {
+    uint64_t num_lines;
+    uint64_t file_size;
+    uint64_t last_end;       // Where the last line's text ends
+    const uint64_t *starts;  // num_lines line starts, in the mapping
+    void *map;
+    size_t map_size;
+} LineIndex;
+
+// Path of input's index ("<input>.idx"), malloc'ed; NULL on failure
+char *line_index_path(const char *input_path);
+
+// Map input_path's index and check it against the input. Returns 0 when
+// the index is valid, 1 when it is missing or stale (nothing to close),
+// -1 on error.
+int line_index_open(LineIndex *index, const char *input_path);
+
+// Scan input_path with num_threads threads and write its index, replacing
+// any old one through a temporary file and rename. Returns 0 or -1.
+int line_index_build(const char *input_path, int num_threads);
+
+// First line that starts at or after byte pos (num_lines if none)
+uint64_t line_index_find(const LineIndex *index, uint64_t pos);
+
+// Byte range [*begin, *end) of line n, newline excluded
+void line_index_line(const LineIndex *index, uint64_t n, uint64_t *begin, uint64_t *end);
+
+void line_index_close(LineIndex *index);
+
+#endif
@@ -0,0 +1,440 @@
+#include "mapped_input.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "affinity.h"
+#include "compressed_input.h"
+#include "line_arena.h"
+#include "line_index.h"
+
+// Initial span capacity, grown by doubling
+#define INITIAL_SPANS 1000000
+
+// Walk the mapping once with memchr and record where every line starts
+// and how long it is. Nothing is copied: workers read the mapping directly.
+static int index_lines(MappedInput *input) {
+    size_t capacity = INITIAL_SPANS;
+    LineSpan *spans = malloc(capacity * sizeof(LineSpan));
+    if (!spans) {
+        perror("Line index allocation failed");
+        return -1;
+    }
+
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos < input->size) {
+        const char *nl = memchr(input->data + pos, '\n', input->size - pos);
+        size_t end = nl ? (size_t)(nl - input->data) : input->size;
+
+        if (count >= capacity) {
+            capacity *= 2;
+            LineSpan *grown = realloc(spans, capacity * sizeof(LineSpan));
+            if (!grown) {
+                perror("Line index reallocation failed");
+                free(spans);
+                return -1;
+            }
+            spans = grown;
+        }
+
+        spans[count].offset = pos;
+        spans[count].length = end - pos;
+        count++;
+        pos = end + 1;
+    }
+
+    input->spans = spans;
+    input->num_lines = count;
+    return 0;
+}
+
+size_t line_start_at(const char *file, size_t file_size, size_t pos) {
+    if (pos == 0 || pos >= file_size) {
+        return (pos == 0) ? 0 : file_size;
+    }
+    const char *nl = memchr(file + pos - 1, '\n', file_size - (pos - 1));
+    return nl ? (size_t)(nl - file) + 1 : file_size;
+}
+
+// Pipes and terminals have no size to map, so read them to the end into
+// an arena that the input then owns
+static int read_unmappable(MappedInput *input, int fd, const char *filename, int num_parts) {
+    if (num_parts > 1) {
+        fprintf(stderr, "Error: %s cannot be mapped, so it cannot be split\n", filename);
+        return -1;
+    }
+    LineArena arena;
+    line_arena_init(&arena);
+    if (line_arena_read_fd(&arena, fd) != 0) {
+        line_arena_free(&arena);
+        return -1;
+    }
+    input->owned = arena.data;
+    input->data = arena.data;
+    input->size = arena.size;
+    input->spans = arena.spans;
+    input->num_lines = arena.num_lines;
+    return 0;
+}
+
+// Which lines of the file a view holds: those starting in byte part
+// part/num_parts, or num_lines lines from first_line
+typedef struct {
+    int part;
+    int num_parts;
+    int by_lines;
+    uint64_t first_line;
+    uint64_t num_lines;
+} ViewRange;
+
+// Spans straight from a line index: no byte of the text is read
+static int spans_from_index(MappedInput *input, const LineIndex *index, uint64_t a, uint64_t b) {
+    size_t count = (size_t)(b - a);
+    input->spans = malloc((count ? count : 1) * sizeof(LineSpan));
+    if (!input->spans) {
+        perror("Line index allocation failed");
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint64_t begin, end;
+        line_index_line(index, a + i, &begin, &end);
+        input->spans[i].offset = begin - input->file_offset;
+        input->spans[i].length = end - begin;
+    }
+    input->num_lines = count;
+    return 0;
+}
+
+// Keep only lines [first, first + count) of a fully indexed view
+static void trim_lines(MappedInput *input, uint64_t first, uint64_t count) {
+    if (first > input->num_lines) {
+        first = input->num_lines;
+    }
+    if (count > input->num_lines - first) {
+        count = input->num_lines - first;
+    }
+    size_t shift = count ? input->spans[first].offset : input->size;
+    size_t end = count ? input->spans[first + count - 1].offset +
+                         input->spans[first + count - 1].length : shift;
+    for (uint64_t i = 0; i < count; i++) {
+        input->spans[i].offset = input->spans[first + i].offset - shift;
+        input->spans[i].length = input->spans[first + i].length;
+    }
+    input->data += shift;
+    input->file_offset += shift;
+    input->size = end - shift;
+    input->num_lines = count;
+}
+
+// Decompression threads: MAXASCII_THREADS, else this process's share of
+// the CPUs when num_parts processes split the input
+static int decompress_threads(int num_parts) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int share = (int)(cpus / num_parts);
+    return thread_count_from_env(share > 0 ? share : 1);
+}
+
+// Text [begin, end) plus what the view cut needs around it: the byte
+// before begin, and the rest of the line running past end. Only the
+// blocks holding that are decompressed. *text starts at text byte
+// *text_offset.
+static int decompress_window(const CompressedInput *z, size_t begin, size_t end, int threads,
+                             char **text, size_t *text_offset, size_t *text_size) {
+    size_t a = compressed_input_find(z, begin > 0 ? begin - 1 : 0);
+    size_t b = compressed_input_find(z, end > 0 ? end - 1 : 0);
+    if (a >= z->num_blocks) {
+        *text = malloc(1);
+        *text_offset = z->text_size;
+        *text_size = 0;
+        return *text ? 0 : -1;
+    }
+    b = (b < z->num_blocks) ? b + 1 : b;
+    size_t off = z->blocks[a].out_offset;
+    size_t len = z->blocks[b - 1].out_offset + z->blocks[b - 1].out_size - off;
+    char *buf = malloc(len);
+    if (!buf) {
+        perror("Decompression buffer allocation failed");
+        return -1;
+    }
+    if (compressed_input_blocks(z, a, b, threads, buf) != 0) {
+        free(buf);
+        return -1;
+    }
+
+    // The last line is finished by the first newline at or after end - 1
+    size_t from = (end > off) ? end - 1 - off : 0;
+    while (b < z->num_blocks && !memchr(buf + from, '\n', len - from)) {
+        size_t more = z->blocks[b].out_size;
+        char *grown = realloc(buf, len + more);
+        if (!grown) {
+            perror("Decompression buffer allocation failed");
+            free(buf);
+            return -1;
+        }
+        buf = grown;
+        if (compressed_input_blocks(z, b, b + 1, 1, buf + len) != 0) {
+            free(buf);
+            return -1;
+        }
+        from = len;
+        len += more;
+        b++;
+    }
+    *text = buf;
+    *text_offset = off;
+    *text_size = len;
+    return 0;
+}
+
+// The view of a compressed file or pipe: decompress what the range needs
+// into a buffer the input owns, then cut and index it like mapped text.
+// Offsets count bytes of the decompressed text. A part view of a
+// block-framed stream decompresses only its own blocks; line ranges are
+// decompressed whole first. A single stream cannot be split: every one of
+// the num_parts processes would inflate and hold all of it to keep 1/num_parts.
+static int open_compressed(MappedInput *input, const char *filename, const void *raw,
+                           size_t raw_size, const ViewRange *range) {
+    CompressedInput z;
+    if (compressed_input_open(&z, raw, raw_size) != 0) {
+        return -1;
+    }
+    if (range->num_parts > 1 && (!z.blocks || z.num_blocks == 1)) {
+        fprintf(stderr,
+                "Error: %s is a single %s stream, so it cannot be split; "
+                "recompress it with bgzip or pzstd\n",
+                filename, compression_name(z.kind));
+        compressed_input_close(&z);
+        return -1;
+    }
+    int threads = decompress_threads(range->num_parts);
+    char *text;
+    size_t text_offset = 0, text_size, total;
+    int rc;
+    if (z.blocks && range->num_parts > 1 && !range->by_lines) {
+        total = z.text_size;
+        rc = decompress_window(&z, total * range->part / range->num_parts,
+                               total * (range->part + 1) / range->num_parts, threads, &text,
+                               &text_offset, &text_size);
+    } else {
+        rc = compressed_input_all(&z, threads, &text, &text_size);
+        total = text_size;
+    }
+    compressed_input_close(&z);
+    if (rc != 0) {
+        return -1;
+    }
+
+    // The window starts before begin whenever begin > 0, so line_start_at
+    // sees the byte that tells whether begin starts a line
+    size_t begin = total * range->part / range->num_parts;
+    size_t end = total * (range->part + 1) / range->num_parts;
+    size_t first = line_start_at(text, text_size, begin - text_offset);
+    size_t last = line_start_at(text, text_size, end - text_offset);
+    if (last < first) {
+        last = first;
+    }
+    input->owned = text;
+    input->data = text + first;
+    input->size = last - first;
+    input->file_offset = text_offset + first;
+    if (index_lines(input) != 0) {
+        return -1;
+    }
+    if (range->by_lines) {
+        trim_lines(input, range->first_line, range->num_lines);
+    }
+    return 0;
+}
+
+static int open_view(MappedInput *input, const char *filename, const ViewRange *range, int want_spans) {
+    memset(input, 0, sizeof(*input));
+    input->fd = -1;
+
+    int use_stdin = (strcmp(filename, "-") == 0);
+    int fd = use_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening file");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Error reading file size");
+        if (!use_stdin) {
+            close(fd);
+        }
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        int rc = read_unmappable(input, fd, filename, range->num_parts);
+        if (rc == 0 && want_spans && compression_detect(input->owned, input->size) != COMPRESSION_NONE) {
+            // Compressed bytes arrived; swap them for the text they hold
+            char *raw = input->owned;
+            size_t raw_size = input->size;
+            free(input->spans);
+            input->spans = NULL;
+            input->owned = NULL;
+            rc = open_compressed(input, filename, raw, raw_size, range);
+            free(raw);
+            if (rc != 0) {
+                mapped_input_close(input);
+            }
+        } else if (rc == 0 && range->by_lines) {
+            trim_lines(input, range->first_line, range->num_lines);
+        }
+        if (!use_stdin) {
+            close(fd);
+        }
+        return rc;
+    }
+    if (use_stdin) {
+        fd = dup(fd);  // A redirected file maps like any other; keep stdin open
+        if (fd < 0) {
+            perror("Error opening file");
+            return -1;
+        }
+    }
+
+    input->fd = fd;
+    input->map_size = (size_t)st.st_size;
+
+    // mmap rejects zero-length mappings; an empty file simply has no lines
+    if (input->map_size > 0) {
+        // Mapping the whole file only reserves address space; pages outside
+        // this part's range are never touched
+        void *map = mmap(NULL, input->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("Error mapping file");
+            close(fd);
+            input->fd = -1;
+            return -1;
+        }
+        input->map = map;
+
+        if (want_spans && compression_detect(map, input->map_size) != COMPRESSION_NONE) {
+            // Once decompressed, the compressed bytes are not needed
+            int rc = open_compressed(input, filename, map, input->map_size, range);
+            munmap(map, input->map_size);
+            close(fd);
+            input->map = NULL;
+            input->fd = -1;
+            if (rc != 0) {
+                mapped_input_close(input);
+            }
+            return rc;
+        }
+
+        // A valid "<file>.idx" places the view and its spans without
+        // scanning; otherwise boundaries come from memchr
+        LineIndex index;
+        int indexed = want_spans && !use_stdin && line_index_open(&index, filename) == 0;
+        size_t begin = input->map_size * range->part / range->num_parts;
+        size_t end = input->map_size * (range->part + 1) / range->num_parts;
+        uint64_t a = 0, b = 0;
+        size_t first, last;
+        if (indexed) {
+            if (range->by_lines) {
+                a = range->first_line < index.num_lines ? range->first_line : index.num_lines;
+                b = range->num_lines < index.num_lines - a ? a + range->num_lines : index.num_lines;
+            } else {
+                a = line_index_find(&index, begin);
+                b = line_index_find(&index, end);
+            }
+            first = (a < index.num_lines) ? index.starts[a] : input->map_size;
+            last = (b < index.num_lines) ? index.starts[b] : input->map_size;
+        } else {
+            first = line_start_at(map, input->map_size, begin);
+            last = line_start_at(map, input->map_size, end);
+            if (last < first) {
+                last = first;  // The whole range sits inside one long line
+            }
+        }
+        input->data = (const char *)map + first;
+        input->size = last - first;
+        input->file_offset = first;
+        if (indexed) {
+            int rc = spans_from_index(input, &index, a, b);
+            line_index_close(&index);
+            if (rc != 0) {
+                mapped_input_close(input);
+                return -1;
+            }
+        }
+
+        // The index pass and the workers both stream front to back, so ask
+        // for aggressive readahead and start paging the range in right away
+        if (input->size > 0) {
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t lo = first & ~(page - 1);
+            madvise((char *)map + lo, last - lo, MADV_SEQUENTIAL);
+            madvise((char *)map + lo, last - lo, MADV_WILLNEED);
+        }
+    }
+
+    if (want_spans && !input->spans) {
+        if (index_lines(input) != 0) {
+            mapped_input_close(input);
+            return -1;
+        }
+        if (range->by_lines) {
+            trim_lines(input, range->first_line, range->num_lines);
+        }
+    }
+    return 0;
+}
+
+int mapped_input_open_part(MappedInput *input, const char *filename, int part, int num_parts) {
+    ViewRange range = {.part = part, .num_parts = num_parts};
+    return open_view(input, filename, &range, 1);
+}
+
+int mapped_input_open(MappedInput *input, const char *filename) {
+    ViewRange range = {.part = 0, .num_parts = 1};
+    return open_view(input, filename, &range, 1);
+}
+
+int mapped_input_open_lines(MappedInput *input, const char *filename, uint64_t first_line,
+                            uint64_t num_lines) {
+    ViewRange range = {.part = 0, .num_parts = 1, .by_lines = 1,
+                       .first_line = first_line, .num_lines = num_lines};
+    return open_view(input, filename, &range, 1);
+}
+
+int mapped_input_map(MappedInput *input, const char *filename) {
+    ViewRange range = {.part = 0, .num_parts = 1};
+    if (open_view(input, filename, &range, 0) != 0) {
+        return -1;
+    }
+    if (input->owned) {
+        fprintf(stderr, "Error: %s is not a regular file\n", filename);
+        mapped_input_close(input);
+        return -1;
+    }
+    Compression kind = compression_detect(input->data, input->size);
+    if (kind != COMPRESSION_NONE) {
+        fprintf(stderr, "Error: %s is %s-compressed; this needs the uncompressed file\n", filename,
+                compression_name(kind));
+        mapped_input_close(input);
+        return -1;
+    }
+    return 0;
+}
+
+void mapped_input_close(MappedInput *input) {
+    if (input->map) {
+        munmap(input->map, input->map_size);
+    }
+    if (input->fd >= 0) {
+        close(input->fd);
+    }
+    free(input->spans);
+    free(input->owned);
+    memset(input, 0, sizeof(*input));
+    input->fd = -1;
+}
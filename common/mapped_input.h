@@ -0,0 +1,70 @@
+#ifndef MAPPED_INPUT_H
+#define MAPPED_INPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One line of the input: [offset, offset + length) inside the mapping,
+// newline excluded
+typedef struct {
+    size_t offset;
+    size_t length;
+} LineSpan;
+
+// Read-only view of an input file mapped straight from the page cache.
+// The view may cover only part of the file (see mapped_input_open_part);
+// offsets are relative to data either way. Inputs that cannot be mapped
+// (pipes, "-" for stdin) are read into a LineArena instead and look the
+// same to callers. gzip and zstd inputs, mapped or piped, are decompressed
+// into memory the view owns (see compressed_input.h); offsets then count
+// bytes of the decompressed text.
+//
+// When the file has a valid "<file>.idx" line index (see line_index.h),
+// views are placed and their spans filled from it without reading the text.
+typedef struct {
+    int fd;
+    void *map;          // Whole-file mapping (NULL for an empty file)
+    size_t map_size;    // File size in bytes
+    const char *data;   // First byte of the lines in this view
+    size_t size;        // Bytes in this view
+    size_t file_offset; // Where data starts in the file
+    LineSpan *spans;    // One span per line, in file order
+    size_t num_lines;
+    char *owned;        // Arena text when the input was read, not mapped
+} MappedInput;
+
+// Map filename and index its line boundaries. Returns 0 on success,
+// -1 on failure (errno is reported with perror). filename may be "-" for
+// standard input.
+int mapped_input_open(MappedInput *input, const char *filename);
+
+// Like mapped_input_open, but the view holds only the lines that start in
+// byte range [size * part / num_parts, size * (part + 1) / num_parts).
+// The parts of 0..num_parts-1 tile the file's lines exactly, and only the
+// pages of this part (plus the tail of its last line) are ever read. For
+// compressed input the range is in decompressed bytes; block-framed
+// streams decompress only the blocks of this part.
+// Unmappable inputs can only be opened whole (num_parts == 1).
+int mapped_input_open_part(MappedInput *input, const char *filename, int part, int num_parts);
+
+// Like mapped_input_open, but the view holds only num_lines lines starting
+// at line first_line (0-based), clipped to the end of the file. With a line
+// index this reads nothing outside those lines; without one the whole file
+// is scanned first.
+int mapped_input_open_lines(MappedInput *input, const char *filename, uint64_t first_line,
+                            uint64_t num_lines);
+
+// Map a regular file whole without indexing its lines: spans stays NULL
+// and num_lines 0 until the caller fills them in. For callers that find
+// line boundaries themselves, or only in part of the file. Compressed
+// files are refused, since these callers need the raw bytes to be the text.
+int mapped_input_map(MappedInput *input, const char *filename);
+
+// First line start at or after byte pos of file: pos itself if it follows
+// a newline, otherwise just past the next newline (or file_size)
+size_t line_start_at(const char *file, size_t file_size, size_t pos);
+
+// Unmap the file and release the line index
+void mapped_input_close(MappedInput *input);
+
+#endif
@@ -0,0 +1,535 @@
+#include "maxascii.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ascii_kernel.h"
+#include "result_cache.h"
+#include "worksteal.h"
+
+#define BLOCK_LINES 256  // Scheduling granularity for work stealing
+
+// ---------------------------------------------------------------------------
+// Threaded helpers shared by the backends
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int id;
+    WorkScheduler *sched;
+    MaJob *job;
+} ComputeArgs;
+
+static void *compute_thread(void *arg) {
+    ComputeArgs *a = (ComputeArgs *)arg;
+    MaJob *job = a->job;
+    size_t num_lines = job->input.num_lines;
+    cpu_placement_pin_self(&job->placement, a->id);
+    phase_thread_enter(&job->timer);
+    size_t block;
+    while (ws_next(a->sched, a->id, &block)) {
+        size_t first = block * BLOCK_LINES;
+        size_t last = first + BLOCK_LINES;
+        if (last > num_lines) {
+            last = num_lines;
+        }
+        for (size_t i = first; i < last; i++) {
+            ma_measure_line(job, i);
+        }
+    }
+    phase_thread_leave(&job->timer, PHASE_COMPUTE);
+    return NULL;
+}
+
+int ma_compute_pthreads(MaJob *job) {
+    const MappedInput *input = &job->input;
+    int num_threads = job->num_threads;
+
+    phase_begin(&job->timer, PHASE_PARTITION);
+    WorkScheduler sched;
+    size_t num_blocks = (input->num_lines + BLOCK_LINES - 1) / BLOCK_LINES;
+    if (ws_init(&sched, num_blocks, num_threads) != 0) {
+        return -1;
+    }
+
+    phase_begin(&job->timer, PHASE_COMPUTE);
+
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    ComputeArgs *args = malloc(num_threads * sizeof(ComputeArgs));
+    if (!threads || !args) {
+        perror("Thread allocation failed");
+        free(threads);
+        free(args);
+        ws_destroy(&sched);
+        return -1;
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+        args[i].id = i;
+        args[i].sched = &sched;
+        args[i].job = job;
+        pthread_create(&threads[i], NULL, compute_thread, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    phase_end(&job->timer);
+
+    free(threads);
+    free(args);
+    ws_destroy(&sched);
+    return 0;
+}
+
+typedef struct {
+    MaJob *job;
+    int id;
+    struct iovec *slot;
+} EncodeArgs;
+
+static void *encode_thread(void *arg) {
+    EncodeArgs *a = (EncodeArgs *)arg;
+    MaJob *job = a->job;
+    cpu_placement_pin_self(&job->placement, a->id);
+    phase_thread_enter(&job->timer);
+    size_t n = job->input.num_lines;
+    size_t first = n * a->id / job->num_threads;
+    size_t last = n * (a->id + 1) / job->num_threads;
+
+    // Metric rows are text; the driver rejects -m with binary formats
+    if (job->stats) {
+        char *buf = malloc(metric_size_bound(job->metrics, last - first) + 1);
+        a->slot->iov_base = buf;
+        a->slot->iov_len = 0;
+        if (buf) {
+            a->slot->iov_len = format_metrics(buf, job->metrics, job->first_line + first,
+                                              job->stats + first, last - first);
+        }
+        phase_thread_leave(&job->timer, PHASE_GATHER);
+        return NULL;
+    }
+
+    char *buf = malloc(encoded_size_bound(job->format, last - first) + 1);
+    a->slot->iov_base = buf;
+    a->slot->iov_len = 0;
+    if (buf) {
+        a->slot->iov_len = encode_results(job->format, buf, job->first_line + first,
+                                          job->results + first, last - first);
+    }
+    phase_thread_leave(&job->timer, PHASE_GATHER);
+    return NULL;
+}
+
+int ma_encode_slices(MaJob *job, struct iovec *iov) {
+    int n = job->num_threads;
+    pthread_t *threads = malloc(n * sizeof(pthread_t));
+    EncodeArgs *args = malloc(n * sizeof(EncodeArgs));
+    if (!threads || !args) {
+        perror("Thread allocation failed");
+        free(threads);
+        free(args);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        args[i].job = job;
+        args[i].id = i;
+        args[i].slot = &iov[i + 1];
+        pthread_create(&threads[i], NULL, encode_thread, &args[i]);
+    }
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+        if (!iov[i + 1].iov_base) {
+            failed = 1;
+        }
+    }
+    free(threads);
+    free(args);
+
+    if (failed) {
+        perror("Output buffer allocation failed");
+        ma_free_slices(job, iov);
+        return -1;
+    }
+    return 0;
+}
+
+void ma_free_slices(const MaJob *job, struct iovec *iov) {
+    for (int i = 0; i < job->num_threads; i++) {
+        free(iov[i + 1].iov_base);
+        iov[i + 1].iov_base = NULL;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Shared-memory defaults
+// ---------------------------------------------------------------------------
+
+static int number_local(MaJob *job) {
+    // first_line stays where the input starts: 0, or a line range's start
+    phase_begin(&job->timer, PHASE_PARTITION);
+    job->total_lines = job->input.num_lines;
+    phase_end(&job->timer);
+    return 0;
+}
+
+static int emit_local(MaJob *job, int fd) {
+    phase_begin(&job->timer, PHASE_GATHER);
+    struct iovec *iov = calloc(job->num_threads + 1, sizeof(struct iovec));
+    if (!iov) {
+        perror("Output buffer allocation failed");
+        return -1;
+    }
+    if (ma_encode_slices(job, iov) != 0) {
+        free(iov);
+        return -1;
+    }
+
+    uint8_t header[RESULT_HEADER_SIZE];
+    encode_header(header, job->format, job->total_lines);
+    iov[0].iov_base = header;
+    iov[0].iov_len = (job->format == OUTPUT_TEXT) ? 0 : RESULT_HEADER_SIZE;
+
+    phase_begin(&job->timer, PHASE_OUTPUT);
+    int rc = writev_all(fd, iov, job->num_threads + 1);
+    if (rc != 0) {
+        perror("Error writing results");
+    }
+    ma_free_slices(job, iov);
+    free(iov);
+    phase_end(&job->timer);
+    return rc;
+}
+
+// ---------------------------------------------------------------------------
+// Job lifecycle
+// ---------------------------------------------------------------------------
+
+int ma_start(MaJob *job, const MaBackend *backend, int *argc, char ***argv) {
+    int num_threads = job->num_threads > 0 ? job->num_threads : 1;
+    OutputFormat format = job->format;
+    int counters = job->counters;
+    unsigned metrics = job->metrics;
+    AffinityPolicy affinity = job->affinity;
+
+    memset(job, 0, sizeof(*job));
+    job->backend = backend;
+    job->num_threads = num_threads;
+    job->format = format;
+    job->counters = counters;
+    job->metrics = metrics;
+    job->affinity = affinity;
+    job->num_procs = 1;
+    job->input.fd = -1;
+    phase_timer_init(&job->timer, counters);
+    if (cpu_placement_init(&job->placement, affinity, num_threads) != 0) {
+        return -1;
+    }
+
+    if (backend->start) {
+        return backend->start(job, argc, argv);
+    }
+    return 0;
+}
+
+// One result byte per line of the opened input, plus a LineStats per line
+// when metrics were requested
+static int alloc_results(MaJob *job) {
+    size_t n = job->input.num_lines ? job->input.num_lines : 1;
+    job->results = malloc(n);
+    if (job->metrics) {
+        job->stats = malloc(n * sizeof(LineStats));
+    }
+    if (!job->results || (job->metrics && !job->stats)) {
+        perror("Result array allocation failed");
+        return -1;
+    }
+    return 0;
+}
+
+int ma_open(MaJob *job, const char *filename) {
+    phase_begin(&job->timer, PHASE_READ);
+    int rc = mapped_input_open_part(&job->input, filename, job->rank, job->num_procs);
+    phase_end(&job->timer);
+    if (rc != 0) {
+        return -1;
+    }
+    return alloc_results(job);
+}
+
+int ma_open_lines(MaJob *job, const char *filename, uint64_t first_line, uint64_t num_lines) {
+    if (job->num_procs != 1) {
+        fprintf(stderr, "Error: line ranges need a shared-memory backend\n");
+        return -1;
+    }
+    phase_begin(&job->timer, PHASE_READ);
+    int rc = mapped_input_open_lines(&job->input, filename, first_line, num_lines);
+    phase_end(&job->timer);
+    if (rc != 0) {
+        return -1;
+    }
+    job->first_line = first_line;
+    return alloc_results(job);
+}
+
+int ma_compute(MaJob *job) {
+    return job->backend->compute(job);
+}
+
+int ma_number(MaJob *job) {
+    if (job->backend->number) {
+        return job->backend->number(job);
+    }
+    return number_local(job);
+}
+
+int ma_emit(MaJob *job, int fd) {
+    if (job->backend->emit) {
+        return job->backend->emit(job, fd);
+    }
+    return emit_local(job, fd);
+}
+
+int ma_report(MaJob *job, const char *path) {
+    if (job->backend->combine_timers) {
+        job->backend->combine_timers(job);
+    }
+    if (job->rank != 0) {
+        return 0;
+    }
+    return phase_timer_save(&job->timer, path, job->backend->name, job->num_procs,
+                            job->num_threads, job->total_lines);
+}
+
+void ma_finish(MaJob *job) {
+    mapped_input_close(&job->input);
+    free(job->results);
+    free(job->stats);
+    job->results = NULL;
+    job->stats = NULL;
+    cpu_placement_free(&job->placement);
+    if (job->backend && job->backend->stop) {
+        job->backend->stop(job);
+    }
+}
+
+void ma_fail(MaJob *job) {
+    if (job->backend && job->backend->abort) {
+        job->backend->abort(job);
+    }
+    ma_finish(job);
+}
+
+// ---------------------------------------------------------------------------
+// Incremental runs
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    MaJob *job;
+    const ResultCache *cache;
+    CacheBlock *blocks;         // This run's blocks
+    const CacheBlock **hits;    // Still-valid cached block, or NULL to rescan
+    uint64_t *first_line;       // Global index of each block's first line
+    size_t trusted;             // Leading blocks reused without hashing
+    WorkScheduler sched;
+    int pass;                   // 0: hash and count lines, 1: fill results
+} BlockRun;
+
+typedef struct {
+    BlockRun *run;
+    int id;
+} BlockArgs;
+
+// Pass 0: hash the block and look it up; rescanned blocks also need their
+// line count before the results array can be laid out
+static void hash_block(BlockRun *run, size_t k) {
+    CacheBlock *block = &run->blocks[k];
+    const char *text = run->job->input.data + block->offset;
+    const CacheBlock *cached = (k < run->trusted) ? &run->cache->blocks[k] : NULL;
+    if (cached && cached->offset == block->offset && cached->length == block->length) {
+        block->hash = cached->hash;  // Append-only: matching boundaries suffice
+    } else {
+        block->hash = cache_hash(text, block->length);
+    }
+    run->hits[k] = result_cache_match(run->cache, k, block->offset, block->length, block->hash);
+    if (run->hits[k]) {
+        block->num_lines = run->hits[k]->num_lines;
+        return;
+    }
+    uint64_t lines = 0;
+    const char *p = text;
+    const char *end = text + block->length;
+    while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+        lines++;
+        p++;
+    }
+    if (block->length > 0 && text[block->length - 1] != '\n') {
+        lines++;  // Unterminated last line of the file
+    }
+    block->num_lines = lines;
+}
+
+// Pass 1: splice cached maxima, or compute them with the fused line scan
+static void fill_block(BlockRun *run, size_t k) {
+    const CacheBlock *block = &run->blocks[k];
+    uint8_t *out = run->job->results + run->first_line[k];
+    if (run->hits[k]) {
+        size_t cached = (size_t)(run->hits[k] - run->cache->blocks);
+        memcpy(out, run->cache->results + run->cache->first_line[cached], block->num_lines);
+        return;
+    }
+    const char *text = run->job->input.data + block->offset;
+    size_t pos = 0;
+    for (uint64_t i = 0; i < block->num_lines; i++) {
+        int max_value;
+        pos += collect_ascii_line(text + pos, block->length - pos, &max_value) + 1;
+        out[i] = (uint8_t)max_value;
+    }
+}
+
+static void *block_thread(void *arg) {
+    BlockArgs *a = (BlockArgs *)arg;
+    BlockRun *run = a->run;
+    cpu_placement_pin_self(&run->job->placement, a->id);
+    phase_thread_enter(&run->job->timer);
+    size_t k;
+    while (ws_next(&run->sched, a->id, &k)) {
+        if (run->pass == 0) {
+            hash_block(run, k);
+        } else {
+            fill_block(run, k);
+        }
+    }
+    phase_thread_leave(&run->job->timer, run->pass == 0 ? PHASE_PARTITION : PHASE_COMPUTE);
+    return NULL;
+}
+
+// Run one pass over every block with num_threads work-stealing threads
+static int run_blocks(BlockRun *run, size_t num_blocks, int pass) {
+    int n = run->job->num_threads;
+    run->pass = pass;
+    if (ws_init(&run->sched, num_blocks, n) != 0) {
+        return -1;
+    }
+    pthread_t *threads = malloc(n * sizeof(pthread_t));
+    BlockArgs *args = malloc(n * sizeof(BlockArgs));
+    if (!threads || !args) {
+        perror("Thread allocation failed");
+        free(threads);
+        free(args);
+        ws_destroy(&run->sched);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        args[i].run = run;
+        args[i].id = i;
+        pthread_create(&threads[i], NULL, block_thread, &args[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(args);
+    ws_destroy(&run->sched);
+    return 0;
+}
+
+int ma_open_cached(MaJob *job, const char *filename, const char *cache_path, int append_only,
+                   MaCacheStats *stats) {
+    if (job->num_procs != 1) {
+        fprintf(stderr, "Error: incremental runs need a shared-memory backend\n");
+        return -1;
+    }
+
+    phase_begin(&job->timer, PHASE_READ);
+    ResultCache cache;
+    if (mapped_input_map(&job->input, filename) != 0 ||
+        result_cache_load(&cache, cache_path, RESULT_CACHE_BLOCK_BYTES) != 0) {
+        phase_end(&job->timer);
+        return -1;
+    }
+
+    // Cut the input into blocks of whole lines. Each boundary is the first
+    // line start at or after its nominal offset, found from the previous
+    // boundary so a line spanning many blocks is only scanned once.
+    phase_begin(&job->timer, PHASE_PARTITION);
+    const MappedInput *input = &job->input;
+    uint64_t block_bytes = RESULT_CACHE_BLOCK_BYTES;
+    size_t num_blocks = (input->size + block_bytes - 1) / block_bytes;
+    BlockRun run = {.job = job, .cache = &cache};
+    if (append_only && cache.num_blocks > 0 && input->size >= cache.file_size) {
+        run.trusted = cache.num_blocks - 1;
+    }
+    run.blocks = calloc(num_blocks ? num_blocks : 1, sizeof(CacheBlock));
+    run.hits = calloc(num_blocks ? num_blocks : 1, sizeof(CacheBlock *));
+    run.first_line = malloc((num_blocks ? num_blocks : 1) * sizeof(uint64_t));
+    int rc = -1;
+    if (!run.blocks || !run.hits || !run.first_line) {
+        perror("Block table allocation failed");
+        goto done;
+    }
+    size_t start = 0;
+    for (size_t k = 0; k < num_blocks; k++) {
+        size_t nominal = (k + 1) * block_bytes;
+        size_t end = line_start_at(input->data, input->size, nominal > start ? nominal : start);
+        run.blocks[k].offset = start;
+        run.blocks[k].length = end - start;
+        start = end;
+    }
+    if (run_blocks(&run, num_blocks, 0) != 0) {
+        goto done;
+    }
+
+    // Lay the blocks out in the results array, then fill it
+    uint64_t total = 0;
+    size_t reused = 0;
+    uint64_t scanned = 0;
+    for (size_t k = 0; k < num_blocks; k++) {
+        run.first_line[k] = total;
+        total += run.blocks[k].num_lines;
+        if (run.hits[k]) {
+            reused++;
+        } else {
+            scanned += run.blocks[k].length;
+        }
+    }
+    phase_begin(&job->timer, PHASE_COMPUTE);
+    job->results = malloc(total ? total : 1);
+    if (!job->results) {
+        perror("Result array allocation failed");
+        goto done;
+    }
+    if (run_blocks(&run, num_blocks, 1) != 0) {
+        goto done;
+    }
+    job->input.num_lines = total;
+    if (stats) {
+        stats->blocks = num_blocks;
+        stats->reused = reused;
+        stats->bytes_scanned = scanned;
+    }
+
+    // The run is valid whether or not the cache can be rewritten, so a
+    // failed save is only reported
+    phase_begin(&job->timer, PHASE_OUTPUT);
+    ResultCache next = {
+        .block_bytes = block_bytes,
+        .file_size = input->map_size,
+        .num_blocks = num_blocks,
+        .blocks = run.blocks,
+        .num_lines = total,
+        .results = job->results,
+    };
+    result_cache_save(&next, cache_path);
+    rc = 0;
+
+done:
+    phase_end(&job->timer);
+    free(run.blocks);
+    free(run.hits);
+    free(run.first_line);
+    result_cache_free(&cache);
+    return rc;
+}
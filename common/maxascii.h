@@ -0,0 +1,163 @@
+#ifndef MAXASCII_H
+#define MAXASCII_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "affinity.h"
+#include "ascii_kernel.h"
+#include "mapped_input.h"
+#include "phase_timer.h"
+#include "result_format.h"
+
+// libmaxascii: per-line max-byte computation with pluggable parallel
+// backends. A run goes through four steps, whatever the backend:
+//
+//   ma_open     map this process's share of the input and index its lines
+//   ma_compute  fill one result byte per line
+//   ma_number   agree on global line numbers (a no-op in shared memory)
+//   ma_emit     write every process's results to one descriptor, in order
+//
+// Shared-memory backends (pthread, openmp) run one process that owns the
+// whole file; the MPI backend gives each rank a byte range of it. Each step
+// charges its time to the job's PhaseTimer.
+
+typedef struct MaBackend MaBackend;
+
+typedef struct {
+    const MaBackend *backend;
+    int num_threads;      // Worker threads per process
+    OutputFormat format;
+    int counters;         // Collect hardware counters per phase
+    unsigned metrics;     // METRIC_* mask; 0 for the plain per-line max
+    AffinityPolicy affinity;  // How worker threads are pinned
+    CpuPlacement placement;   // Planned by ma_start from affinity
+
+    int rank;             // This process and the process count; 0 and 1
+    int num_procs;        // unless the backend is distributed
+
+    MappedInput input;    // This process's lines
+    uint8_t *results;     // One max per line of input
+    LineStats *stats;     // With metrics: every measurement per line
+    uint64_t first_line;  // Global number of this process's first line
+    uint64_t total_lines; // Lines over all processes
+
+    PhaseTimer timer;     // Started by ma_start
+} MaJob;
+
+struct MaBackend {
+    const char *name;
+    // Set up the runtime and fill rank/num_procs. May be NULL.
+    int (*start)(MaJob *job, int *argc, char ***argv);
+    // Fill job->results for every line of job->input
+    int (*compute)(MaJob *job);
+    // Set first_line and total_lines. NULL means the shared-memory default.
+    int (*number)(MaJob *job);
+    // Write the encoded results in global line order. NULL means the
+    // shared-memory default (parallel encode, one writev).
+    int (*emit)(MaJob *job, int fd);
+    // Tear the runtime down. May be NULL.
+    void (*stop)(MaJob *job);
+    // Bring every process down after a local error, so peers blocked in a
+    // collective do not hang. May be NULL.
+    void (*abort)(MaJob *job);
+    // Fold every process's timer into rank 0's. May be NULL.
+    void (*combine_timers)(MaJob *job);
+};
+
+// The backends themselves; the MPI one only in builds with MPI
+extern const MaBackend ma_backend_pthread;
+extern const MaBackend ma_backend_openmp;
+#ifdef MAXASCII_WITH_MPI
+extern const MaBackend ma_backend_mpi;
+#endif
+
+// Backends compiled into this build, and lookup by name
+extern const MaBackend *const ma_backends[];
+const MaBackend *ma_find_backend(const char *name);
+
+// The whole command line of a program built on this library: parse the
+// options, run one job and print the summary. backends is a NULL-terminated
+// list whose first entry is the default; -b is offered only when it holds
+// more than one. Returns the exit status. Linking just the backends named
+// keeps the others' runtimes out of the program.
+int ma_main(int argc, char *argv[], const MaBackend *const backends[], int default_threads);
+
+// Initialise a job for backend and start its runtime
+int ma_start(MaJob *job, const MaBackend *backend, int *argc, char ***argv);
+
+// The four steps above; each returns 0 on success, -1 on error
+int ma_open(MaJob *job, const char *filename);
+int ma_compute(MaJob *job);
+int ma_number(MaJob *job);
+int ma_emit(MaJob *job, int fd);
+
+// Line-range job for shared-memory backends: like ma_open, but only lines
+// [first_line, first_line + num_lines), numbered from first_line in the
+// output. Instant with a line index (see line_index.h).
+int ma_open_lines(MaJob *job, const char *filename, uint64_t first_line, uint64_t num_lines);
+
+// Incremental alternative to ma_open + ma_compute for shared-memory
+// backends: map filename and fill job->results, reusing every block whose
+// range and hash still match the sidecar cache at cache_path (see
+// result_cache.h), then rewrite the cache. job->input is left unindexed
+// (spans is NULL). stats, if not NULL, receives what was reused.
+//
+// Checking every hash costs one read pass over the whole file. With
+// append_only set, a file that has not shrunk is assumed to have only been
+// appended to: cached blocks are reused on matching boundaries alone and
+// only the last cached block is hashed, so the cost follows the new data.
+// Edits in place before the last cached block then go unnoticed.
+typedef struct {
+    size_t blocks;            // Blocks in the input
+    size_t reused;            // Blocks spliced from the cache
+    uint64_t bytes_scanned;   // Bytes of the blocks that were recomputed
+} MaCacheStats;
+
+int ma_open_cached(MaJob *job, const char *filename, const char *cache_path, int append_only,
+                   MaCacheStats *stats);
+
+// Write the phase timings as JSON to path (rank 0 only; every process must
+// call it). Returns 0 or -1.
+int ma_report(MaJob *job, const char *path);
+
+// Release the input and results and stop the backend runtime
+void ma_finish(MaJob *job);
+
+// Give up after an error in any step: aborts distributed runs, otherwise
+// behaves like ma_finish
+void ma_fail(MaJob *job);
+
+// Shared building blocks for backends
+
+// Measure line i of job->input into job->results, and into job->stats
+// when metrics were requested: the UTF-8 pass for codepoint metrics, the
+// fused byte statistics pass for the others. Either one sets the max.
+static inline void ma_measure_line(MaJob *job, size_t i) {
+    const LineSpan *span = &job->input.spans[i];
+    const char *line = job->input.data + span->offset;
+    if (!job->stats) {
+        job->results[i] = collect_ascii_values(line, span->length);
+        return;
+    }
+    LineStats *stats = &job->stats[i];
+    if (job->metrics & METRIC_UTF8) {
+        collect_utf8_stats(line, span->length, stats);
+    }
+    if (job->metrics & METRIC_BYTE_STATS) {
+        collect_line_stats(line, span->length, stats);
+    }
+    job->results[i] = stats->max;
+}
+
+// Compute job->results with num_threads pthreads and work stealing;
+// worker i is pinned to placement slot i
+int ma_compute_pthreads(MaJob *job);
+
+// Encode this process's results into num_threads slices in parallel.
+// iov[0] is left free for the caller (e.g. a header), slices fill
+// iov[1..num_threads]. Free the slices with ma_free_slices.
+int ma_encode_slices(MaJob *job, struct iovec *iov);
+void ma_free_slices(const MaJob *job, struct iovec *iov);
+
+#endif
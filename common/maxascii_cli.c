@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "maxascii.h"
+#include "range_max.h"
+#include "stream.h"
+
+#define FILE_NAME "wiki_dump.txt"
+
+// Command line shared by the maxascii driver and the 3way programs, which
+// differ only in the backends they offer and their default thread count
+
+static void usage(const char *prog, const MaBackend *const backends[], int default_threads) {
+    if (backends[1]) {
+        fprintf(stderr, "Usage: %s [-b backend] [-s] [-t threads] [-a policy] [-i|-A] [-r first:count] [-R rmq] [-m metrics] [-f text|bin|rle] [-j json [-c]] [file]\n", prog);
+        fprintf(stderr, "  -b  parallel backend:");
+        for (int i = 0; backends[i]; i++) {
+            fprintf(stderr, " %s", backends[i]->name);
+        }
+        fprintf(stderr, " (default %s)\n", backends[0]->name);
+    } else {
+        fprintf(stderr, "Usage: %s [-s] [-t threads] [-a policy] [-i|-A] [-r first:count] [-R rmq] [-m metrics] [-f text|bin|rle] [-j json [-c]] [file]\n", prog);
+    }
+    fprintf(stderr, "  -s  stream the input through a fixed-size block ring ('-' reads stdin);\n");
+    fprintf(stderr, "      constant memory, one process only\n");
+    fprintf(stderr, "  -t  worker threads per process (default $MAXASCII_THREADS, else %d)\n", default_threads);
+    fprintf(stderr, "  -a  pin workers: none, compact, scatter or numa (default $MAXASCII_AFFINITY,\n");
+    fprintf(stderr, "      else none); with several ranks per node, bind ranks with mpirun instead\n");
+    fprintf(stderr, "  -i  incremental: reuse unchanged blocks from the <file>.maxcache sidecar\n");
+    fprintf(stderr, "      and rewrite it (pthread/openmp backends, regular files only)\n");
+    fprintf(stderr, "  -A  like -i, but assume the file was only appended to and skip hashing\n");
+    fprintf(stderr, "      the blocks before the last cached one\n");
+    fprintf(stderr, "  -r  only count lines from line first (0-based); instant with a <file>.idx\n");
+    fprintf(stderr, "      index from tools/line_index (pthread/openmp backends)\n");
+    fprintf(stderr, "  -R  also save a range-max structure over the results (see tools/max_query)\n");
+    fprintf(stderr, "  -m  per-line metrics, any of max,min,len,nonascii,ctrl (one pass) and\n");
+    fprintf(stderr, "      cp,invalid (max UTF-8 codepoint, ill-formed flag); rows become\n");
+    fprintf(stderr, "      \"<line>: <values>\" in that order (text output only)\n");
+    fprintf(stderr, "  -f  output format: text rows (default), packed bytes, or run-length encoded\n");
+    fprintf(stderr, "  -j  write per-phase timings to this JSON file\n");
+    fprintf(stderr, "  -c  add hardware counters (perf_event_open) to the timings\n");
+}
+
+static const MaBackend *find_backend(const MaBackend *const backends[], const char *name) {
+    for (int i = 0; backends[i]; i++) {
+        if (strcmp(backends[i]->name, name) == 0) {
+            return backends[i];
+        }
+    }
+    return NULL;
+}
+
+// Streaming mode: constant memory, results are written as blocks finish.
+// Reading, computing and writing overlap, so the whole pipeline is charged
+// to compute.
+static int run_stream(MaJob *job, const char *filename, const char *timing_path, FILE *info) {
+    phase_begin(&job->timer, PHASE_COMPUTE);
+    long long streamed = stream_process(filename, job->num_threads, &job->placement, job->format,
+                                        stdout);
+    phase_end(&job->timer);
+    if (streamed < 0) {
+        return -1;
+    }
+    fprintf(info, "Total lines read: %lld\n", streamed);
+    if (timing_path && phase_timer_save(&job->timer, timing_path, "pthread-stream", 1,
+                                        job->num_threads, (uint64_t)streamed) != 0) {
+        return -1;
+    }
+    fprintf(info, "Execution time: %.2f seconds\n", phase_total(&job->timer));
+    return 0;
+}
+
+int ma_main(int argc, char *argv[], const MaBackend *const backends[], int default_threads) {
+    const MaBackend *backend = backends[0];
+    MaJob job = {.num_threads = thread_count_from_env(default_threads), .format = OUTPUT_TEXT};
+    const char *timing_path = NULL;
+    const char *rmq_path = NULL;
+    int streaming = 0;
+    int incremental = 0;
+    int append_only = 0;
+    int line_range = 0;
+    unsigned long long range_first = 0, range_count = 0;
+    if (affinity_from_env(&job.affinity) != 0) {
+        return 1;
+    }
+
+    int opt;
+    while ((opt = getopt(argc, argv, backends[1] ? "b:st:a:iAr:R:m:f:j:c" : "st:a:iAr:R:m:f:j:c")) != -1) {
+        switch (opt) {
+        case 'j':
+            timing_path = optarg;
+            break;
+        case 'c':
+            job.counters = 1;
+            break;
+        case 'R':
+            rmq_path = optarg;
+            break;
+        case 'm':
+            if (parse_metrics(optarg, &job.metrics) == 0) {
+                break;
+            }
+            fprintf(stderr, "Unknown metric in '%s'\n", optarg);
+            usage(argv[0], backends, default_threads);
+            return 1;
+        case 'r':
+            if (sscanf(optarg, "%llu:%llu", &range_first, &range_count) == 2) {
+                line_range = 1;
+                break;
+            }
+            fprintf(stderr, "Line range must be first:count\n");
+            usage(argv[0], backends, default_threads);
+            return 1;
+        case 's':
+            streaming = 1;
+            break;
+        case 'A':
+            append_only = 1;
+            /* fall through */
+        case 'i':
+            incremental = 1;
+            break;
+        case 'b':
+            backend = find_backend(backends, optarg);
+            if (backend) {
+                break;
+            }
+            fprintf(stderr, "Unknown backend '%s'\n", optarg);
+            usage(argv[0], backends, default_threads);
+            return 1;
+        case 't':
+            job.num_threads = atoi(optarg);
+            if (job.num_threads > 0) {
+                break;
+            }
+            fprintf(stderr, "Thread count must be positive\n");
+            usage(argv[0], backends, default_threads);
+            return 1;
+        case 'a':
+            if (parse_affinity_policy(optarg, &job.affinity) == 0) {
+                break;
+            }
+            fprintf(stderr, "Unknown affinity policy '%s'\n", optarg);
+            usage(argv[0], backends, default_threads);
+            return 1;
+        case 'f':
+            if (parse_output_format(optarg, &job.format) == 0) {
+                break;
+            }
+            fprintf(stderr, "Unknown output format '%s'\n", optarg);
+            /* fall through */
+        default:
+            usage(argv[0], backends, default_threads);
+            return 1;
+        }
+    }
+    char *filename = (optind < argc) ? argv[optind] : FILE_NAME;
+    if (job.metrics && job.format != OUTPUT_TEXT) {
+        fprintf(stderr, "Metrics are written as text rows; drop -f\n");
+        return 1;
+    }
+    if (job.metrics && incremental) {
+        fprintf(stderr, "The result cache holds only the max; -m cannot be combined with -i\n");
+        return 1;
+    }
+    if (streaming && (job.metrics || incremental || line_range || rmq_path)) {
+        fprintf(stderr, "The stream computes the plain max of every line; drop -m, -i, -r and -R\n");
+        return 1;
+    }
+
+    // Options come first so the thread count is known when the runtime starts
+    if (ma_start(&job, backend, &argc, &argv) != 0) {
+        return 1;
+    }
+
+    // Binary output owns stdout, so progress messages move to stderr
+    FILE *info = (job.format == OUTPUT_TEXT) ? stdout : stderr;
+
+    if (streaming) {
+        if (job.num_procs != 1) {
+            fprintf(stderr, "Streaming runs in one process\n");
+            ma_fail(&job);
+            return 1;
+        }
+        int rc = run_stream(&job, filename, timing_path, info);
+        ma_finish(&job);
+        return rc == 0 ? 0 : 1;
+    }
+
+    // Incremental runs splice unchanged blocks from the sidecar cache in
+    // place of ma_open + ma_compute
+    int loaded;
+    MaCacheStats cache_stats;
+    char *cache_path = NULL;
+    if (incremental && line_range) {
+        fprintf(stderr, "Incremental runs always cover the whole file\n");
+        ma_fail(&job);
+        return 1;
+    }
+    if (incremental && strcmp(filename, "-") == 0) {
+        fprintf(stderr, "Incremental runs need a named file to keep the cache next to\n");
+        ma_fail(&job);
+        return 1;
+    }
+    if (incremental) {
+        size_t len = strlen(filename) + sizeof(".maxcache");
+        cache_path = malloc(len);
+        if (!cache_path) {
+            perror("Cache path allocation failed");
+            ma_fail(&job);
+            return 1;
+        }
+        snprintf(cache_path, len, "%s.maxcache", filename);
+        loaded = ma_open_cached(&job, filename, cache_path, append_only, &cache_stats);
+    } else if (line_range) {
+        loaded = ma_open_lines(&job, filename, range_first, range_count) == 0 ? ma_compute(&job) : -1;
+    } else {
+        loaded = ma_open(&job, filename) == 0 ? ma_compute(&job) : -1;
+    }
+    free(cache_path);
+    if (loaded != 0 || ma_number(&job) != 0) {
+        ma_fail(&job);
+        return 1;
+    }
+    if (incremental) {
+        fprintf(stderr, "Cache: reused %zu of %zu blocks, rescanned %llu bytes\n",
+                cache_stats.reused, cache_stats.blocks,
+                (unsigned long long)cache_stats.bytes_scanned);
+    }
+    if (job.rank == 0) {
+        fprintf(info, "Total lines read: %llu\n", (unsigned long long)job.total_lines);
+        fflush(info);
+    }
+    if (ma_emit(&job, STDOUT_FILENO) != 0) {
+        ma_fail(&job);
+        return 1;
+    }
+
+    // Range-max structure over this process's results; rows of a line
+    // range are indexed from the range's first line
+    if (rmq_path) {
+        RangeMax rmq;
+        int rc = -1;
+        if (job.num_procs != 1) {
+            fprintf(stderr, "Range-max output needs a shared-memory backend\n");
+        } else if (range_max_build(&rmq, job.results, job.input.num_lines) == 0) {
+            rc = range_max_save(&rmq, rmq_path);
+            range_max_free(&rmq);
+        }
+        if (rc != 0) {
+            ma_fail(&job);
+            return 1;
+        }
+    }
+
+    if (timing_path && ma_report(&job, timing_path) != 0) {
+        ma_fail(&job);
+        return 1;
+    }
+    if (job.rank == 0) {
+        fprintf(info, "Execution time: %.2f seconds\n", phase_total(&job.timer));
+        fprintf(info, "Processed with %s, %d process(es) x %d thread(s)\n",
+                backend->name, job.num_procs, job.num_threads);
+    }
+    ma_finish(&job);
+    return 0;
+}
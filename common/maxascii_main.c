@@ -0,0 +1,12 @@
+#include "maxascii.h"
+
+#define DEFAULT_THREADS 20
+
+// Single driver for every backend compiled into libmaxascii:
+//   maxascii -b pthread -t 8 file
+//   maxascii -b openmp -f bin file > out.bin
+//   mpirun -np 4 maxascii -b mpi -t 4 file
+
+int main(int argc, char *argv[]) {
+    return ma_main(argc, argv, ma_backends, DEFAULT_THREADS);
+}
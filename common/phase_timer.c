@@ -0,0 +1,202 @@
+#define _GNU_SOURCE  // syscall()
+
+#include "phase_timer.h"
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Hardware events behind the first three counters; bytes read come from
+// /proc/self/io instead
+#define HW_COUNTERS 3
+static const uint64_t hw_events[HW_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,  // Last-level cache on x86
+};
+
+static const char *const phase_names[PHASE_COUNT] = {
+    "read", "partition", "compute", "gather", "output"
+};
+
+static const char *const counter_names[COUNTER_COUNT] = {
+    "cycles", "instructions", "llc_misses", "bytes_read"
+};
+
+// Counters of the calling thread while it is inside a phase. Each thread
+// opens its own (no inherit), so OpenMP pool threads that outlive a phase
+// are still charged to the right one.
+static __thread int tl_fds[HW_COUNTERS];
+static __thread int tl_open;
+
+double phase_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int open_counter(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;  // Allowed at the default perf_event_paranoid
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t read_counter(int fd) {
+    uint64_t value = 0;
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) {
+        return 0;
+    }
+    return value;
+}
+
+// Storage bytes read by the whole process so far
+static uint64_t io_bytes_read(void) {
+    FILE *f = fopen("/proc/self/io", "r");
+    if (!f) {
+        return 0;
+    }
+    char key[64];
+    unsigned long long value;
+    uint64_t bytes = 0;
+    while (fscanf(f, "%63[^:]: %llu\n", key, &value) == 2) {
+        if (strcmp(key, "read_bytes") == 0) {
+            bytes = value;
+            break;
+        }
+    }
+    fclose(f);
+    return bytes;
+}
+
+void phase_thread_enter(const PhaseTimer *timer) {
+    if (!timer->counters || tl_open) {
+        return;
+    }
+    for (int k = 0; k < HW_COUNTERS; k++) {
+        tl_fds[k] = open_counter(hw_events[k]);
+    }
+    tl_open = 1;
+}
+
+void phase_thread_leave(PhaseTimer *timer, Phase phase) {
+    if (!tl_open) {
+        return;
+    }
+    for (int k = 0; k < HW_COUNTERS; k++) {
+        if (tl_fds[k] < 0) {
+            continue;
+        }
+        uint64_t value = read_counter(tl_fds[k]);
+        close(tl_fds[k]);
+        __atomic_fetch_add(&timer->counts[phase][k], value, __ATOMIC_RELAXED);
+        __atomic_store_n(&timer->available[k], 1, __ATOMIC_RELAXED);
+    }
+    tl_open = 0;
+}
+
+void phase_timer_init(PhaseTimer *timer, int with_counters) {
+    memset(timer, 0, sizeof(*timer));
+    timer->counters = with_counters;
+    timer->current = -1;
+    timer->run_start = phase_now();
+    if (with_counters) {
+        timer->available[COUNTER_BYTES_READ] = access("/proc/self/io", R_OK) == 0;
+    }
+}
+
+void phase_begin(PhaseTimer *timer, Phase phase) {
+    phase_end(timer);
+    timer->current = phase;
+    if (timer->counters) {
+        timer->io_start = io_bytes_read();
+        phase_thread_enter(timer);
+    }
+    timer->phase_start = phase_now();
+}
+
+void phase_end(PhaseTimer *timer) {
+    if (timer->current < 0) {
+        return;
+    }
+    Phase phase = (Phase)timer->current;
+    timer->seconds[phase] += phase_now() - timer->phase_start;
+    if (timer->counters) {
+        phase_thread_leave(timer, phase);
+        timer->counts[phase][COUNTER_BYTES_READ] += io_bytes_read() - timer->io_start;
+    }
+    timer->current = -1;
+}
+
+void phase_split(PhaseTimer *timer, Phase next, double at) {
+    if (timer->current >= 0) {
+        Phase phase = (Phase)timer->current;
+        timer->seconds[phase] += at - timer->phase_start;
+        if (timer->counters) {
+            phase_thread_leave(timer, phase);
+            timer->counts[phase][COUNTER_BYTES_READ] += io_bytes_read() - timer->io_start;
+        }
+    }
+    timer->current = next;
+    if (timer->counters) {
+        timer->io_start = io_bytes_read();
+        phase_thread_enter(timer);
+    }
+    timer->phase_start = at;
+}
+
+double phase_total(const PhaseTimer *timer) {
+    return phase_now() - timer->run_start;
+}
+
+const char *phase_name(Phase phase) {
+    return phase_names[phase];
+}
+
+int phase_timer_write_json(const PhaseTimer *timer, FILE *out, const char *backend,
+                           int processes, int threads, uint64_t lines) {
+    fprintf(out, "{\"backend\": \"%s\", \"processes\": %d, \"threads\": %d, "
+            "\"lines\": %llu, \"total_seconds\": %.6f, \"phases\": {",
+            backend, processes, threads, (unsigned long long)lines, phase_total(timer));
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        fprintf(out, "%s\"%s\": {\"seconds\": %.6f", p ? ", " : "",
+                phase_names[p], timer->seconds[p]);
+        if (timer->counters) {
+            for (int k = 0; k < COUNTER_COUNT; k++) {
+                if (timer->available[k]) {
+                    fprintf(out, ", \"%s\": %llu", counter_names[k],
+                            (unsigned long long)timer->counts[p][k]);
+                } else {
+                    fprintf(out, ", \"%s\": null", counter_names[k]);
+                }
+            }
+        }
+        fputc('}', out);
+    }
+    fputs("}}\n", out);
+    return ferror(out) ? -1 : 0;
+}
+
+int phase_timer_save(const PhaseTimer *timer, const char *path, const char *backend,
+                     int processes, int threads, uint64_t lines) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror("Error opening timing report");
+        return -1;
+    }
+    int rc = phase_timer_write_json(timer, out, backend, processes, threads, lines);
+    if (fclose(out) != 0) {
+        rc = -1;
+    }
+    if (rc != 0) {
+        perror("Error writing timing report");
+    }
+    return rc;
+}
@@ -0,0 +1,96 @@
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Per-phase instrumentation shared by all backends. Every run is split into
+// the same five phases so backends can be compared side by side:
+//
+//   read       bring the input in (map and index lines, MPI-IO range read,
+//              arena read of a pipe)
+//   partition  hand out the work (deques, thread ranges, global numbering)
+//   compute    per-line maxima
+//   gather     encode results and move them towards the writer
+//   output     write the result file (at MPI rank 0 this includes waiting
+//              for the other ranks' rows)
+//
+// Wall-clock seconds are always recorded. With counters enabled, each phase
+// also gets CPU cycles, instructions and last-level cache misses from
+// perf_event_open, summed over every thread that reports into it, and the
+// bytes the process read from storage (/proc/self/io). Counters that the
+// kernel refuses (no PMU in a VM, perf_event_paranoid) are reported as null.
+
+typedef enum {
+    PHASE_READ,
+    PHASE_PARTITION,
+    PHASE_COMPUTE,
+    PHASE_GATHER,
+    PHASE_OUTPUT,
+    PHASE_COUNT
+} Phase;
+
+typedef enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_BYTES_READ,
+    COUNTER_COUNT
+} Counter;
+
+typedef struct {
+    double seconds[PHASE_COUNT];
+    uint64_t counts[PHASE_COUNT][COUNTER_COUNT];
+    int counters;                   // Counters requested
+    int available[COUNTER_COUNT];   // Counter could be opened at least once
+
+    // Phase in progress on the calling (main) thread
+    int current;                    // -1 when none
+    double phase_start;
+    uint64_t io_start;
+    double run_start;
+} PhaseTimer;
+
+// Monotonic wall-clock time in seconds
+double phase_now(void);
+
+// Start timing a run. with_counters enables the hardware counters.
+void phase_timer_init(PhaseTimer *timer, int with_counters);
+
+// Begin phase on the calling thread, ending the current one first; the
+// calling thread's counters are charged to it
+void phase_begin(PhaseTimer *timer, Phase phase);
+
+// End the current phase, if any
+void phase_end(PhaseTimer *timer);
+
+// End the current phase at time at (a phase_now() value taken earlier,
+// e.g. by a worker thread) and charge the time since to next. For phase
+// boundaries that worker threads cross without returning to the caller.
+void phase_split(PhaseTimer *timer, Phase next, double at);
+
+// Worker threads bracket the part of their work that belongs to a phase
+// with these so their counters are included; they cost nothing without
+// counters. A thread may leave one phase and enter the next.
+void phase_thread_enter(const PhaseTimer *timer);
+void phase_thread_leave(PhaseTimer *timer, Phase phase);
+
+// Seconds since phase_timer_init
+double phase_total(const PhaseTimer *timer);
+
+// Name used in reports ("read", "compute", ...)
+const char *phase_name(Phase phase);
+
+// Write the run as one JSON object:
+//   {"backend": ..., "processes": P, "threads": T, "lines": N,
+//    "total_seconds": s, "phases": {"read": {"seconds": s, "cycles": c,
+//    "instructions": i, "llc_misses": m, "bytes_read": b}, ...}}
+// Counter fields appear only when counters were requested.
+int phase_timer_write_json(const PhaseTimer *timer, FILE *out, const char *backend,
+                           int processes, int threads, uint64_t lines);
+
+// Convenience: write the JSON report to path. Returns 0 or -1.
+int phase_timer_save(const PhaseTimer *timer, const char *path, const char *backend,
+                     int processes, int threads, uint64_t lines);
+
+#endif
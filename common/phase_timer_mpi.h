@@ -0,0 +1,23 @@
+#ifndef PHASE_TIMER_MPI_H
+#define PHASE_TIMER_MPI_H
+
+#include <mpi.h>
+
+#include "phase_timer.h"
+
+// Combine every rank's timer into rank 0's: a phase lasts as long as its
+// slowest rank, and counters add up. Header-only so the library itself
+// does not need MPI.
+static inline void phase_timer_reduce(PhaseTimer *timer, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    void *send_seconds = (rank == 0) ? MPI_IN_PLACE : timer->seconds;
+    void *send_counts = (rank == 0) ? MPI_IN_PLACE : timer->counts;
+    void *send_available = (rank == 0) ? MPI_IN_PLACE : timer->available;
+    MPI_Reduce(send_seconds, timer->seconds, PHASE_COUNT, MPI_DOUBLE, MPI_MAX, 0, comm);
+    MPI_Reduce(send_counts, timer->counts, PHASE_COUNT * COUNTER_COUNT,
+               MPI_UINT64_T, MPI_SUM, 0, comm);
+    MPI_Reduce(send_available, timer->available, COUNTER_COUNT, MPI_INT, MPI_MIN, 0, comm);
+}
+
+#endif
@@ -0,0 +1,182 @@
+#include "range_max.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t num_lines;
+    uint32_t block;
+    uint32_t levels;
+    uint64_t num_blocks;
+} RangeMaxHeader;
+
+// Max of len bytes; len is at most two blocks, and the loop vectorises
+static inline uint8_t scan_max(const uint8_t *values, size_t len) {
+    uint8_t m = 0;
+    for (size_t i = 0; i < len; i++) {
+        m = values[i] > m ? values[i] : m;
+    }
+    return m;
+}
+
+static inline int floor_log2(uint64_t x) {
+    return 63 - __builtin_clzll(x);
+}
+
+int range_max_build(RangeMax *rmq, const uint8_t *values, uint64_t num_lines) {
+    memset(rmq, 0, sizeof(*rmq));
+    uint64_t num_blocks = (num_lines + RANGE_MAX_BLOCK - 1) / RANGE_MAX_BLOCK;
+    int levels = num_blocks ? floor_log2(num_blocks) + 1 : 0;
+
+    uint8_t *owned = malloc(num_lines + (size_t)levels * num_blocks + 1);
+    if (!owned) {
+        perror("Range-max allocation failed");
+        return -1;
+    }
+    memcpy(owned, values, num_lines);
+    uint8_t *table = owned + num_lines;
+
+    // Row 0 holds each block's max; row j combines two halves of row j-1.
+    // Entries whose span runs past the end are never read.
+    for (uint64_t b = 0; b < num_blocks; b++) {
+        uint64_t lo = b * RANGE_MAX_BLOCK;
+        uint64_t hi = lo + RANGE_MAX_BLOCK < num_lines ? lo + RANGE_MAX_BLOCK : num_lines;
+        table[b] = scan_max(owned + lo, hi - lo);
+    }
+    for (int j = 1; j < levels; j++) {
+        const uint8_t *prev = table + (size_t)(j - 1) * num_blocks;
+        uint8_t *row = table + (size_t)j * num_blocks;
+        uint64_t half = (uint64_t)1 << (j - 1);
+        for (uint64_t i = 0; i + 2 * half <= num_blocks; i++) {
+            row[i] = prev[i] > prev[i + half] ? prev[i] : prev[i + half];
+        }
+    }
+
+    rmq->num_lines = num_lines;
+    rmq->values = owned;
+    rmq->num_blocks = num_blocks;
+    rmq->levels = levels;
+    rmq->table = table;
+    rmq->owned = owned;
+    return 0;
+}
+
+uint8_t range_max_query(const RangeMax *rmq, uint64_t first, uint64_t last) {
+    uint64_t fb = first / RANGE_MAX_BLOCK;
+    uint64_t lb = last / RANGE_MAX_BLOCK;
+    if (lb - fb <= 1) {
+        return scan_max(rmq->values + first, last - first + 1);
+    }
+
+    // Partial blocks at both ends, then whole blocks fb+1..lb-1 as two
+    // overlapping power-of-two spans from the table
+    uint64_t head_end = (fb + 1) * RANGE_MAX_BLOCK;
+    uint64_t tail_start = lb * RANGE_MAX_BLOCK;
+    uint8_t m = scan_max(rmq->values + first, head_end - first);
+    uint8_t t = scan_max(rmq->values + tail_start, last - tail_start + 1);
+    m = t > m ? t : m;
+
+    uint64_t count = lb - fb - 1;
+    int j = floor_log2(count);
+    const uint8_t *row = rmq->table + (size_t)j * rmq->num_blocks;
+    uint8_t a = row[fb + 1];
+    uint8_t b = row[lb - ((uint64_t)1 << j)];
+    a = a > b ? a : b;
+    return a > m ? a : m;
+}
+
+int range_max_save(const RangeMax *rmq, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror("Error creating range-max file");
+        return -1;
+    }
+    RangeMaxHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RANGE_MAX_MAGIC, 4);
+    header.version = RANGE_MAX_VERSION;
+    header.num_lines = rmq->num_lines;
+    header.block = RANGE_MAX_BLOCK;
+    header.levels = (uint32_t)rmq->levels;
+    header.num_blocks = rmq->num_blocks;
+
+    size_t table_size = (size_t)rmq->levels * rmq->num_blocks;
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(rmq->values, 1, rmq->num_lines, f) == rmq->num_lines &&
+             fwrite(rmq->table, 1, table_size, f) == table_size;
+    if (fclose(f) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        perror("Error writing range-max file");
+        return -1;
+    }
+    return 0;
+}
+
+int range_max_is_saved(const uint8_t *head, size_t len) {
+    return len >= 4 && memcmp(head, RANGE_MAX_MAGIC, 4) == 0;
+}
+
+int range_max_load(RangeMax *rmq, const char *path) {
+    memset(rmq, 0, sizeof(*rmq));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening range-max file");
+        return -1;
+    }
+    struct stat st;
+    RangeMaxHeader header;
+    int valid = fstat(fd, &st) == 0 &&
+                pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                memcmp(header.magic, RANGE_MAX_MAGIC, 4) == 0 &&
+                header.version == RANGE_MAX_VERSION &&
+                header.block == RANGE_MAX_BLOCK &&
+                header.num_lines <= (uint64_t)st.st_size;
+    // Queries trust the table's shape, so it must be exactly the one
+    // range_max_build makes for num_lines, not just fit the file size
+    if (valid) {
+        uint64_t blocks = header.num_lines / RANGE_MAX_BLOCK +
+                          (header.num_lines % RANGE_MAX_BLOCK != 0);
+        uint32_t levels = blocks ? (uint32_t)floor_log2(blocks) + 1 : 0;
+        valid = header.num_blocks == blocks && header.levels == levels &&
+                (uint64_t)st.st_size == sizeof(header) + header.num_lines +
+                                        (uint64_t)header.levels * header.num_blocks;
+    }
+    if (!valid) {
+        fprintf(stderr, "Error: %s is not a usable range-max file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error mapping range-max file");
+        return -1;
+    }
+    const uint8_t *values = (const uint8_t *)map + sizeof(header);
+    rmq->num_lines = header.num_lines;
+    rmq->values = values;
+    rmq->num_blocks = header.num_blocks;
+    rmq->levels = (int)header.levels;
+    rmq->table = values + header.num_lines;
+    rmq->map = map;
+    rmq->map_size = (size_t)st.st_size;
+    return 0;
+}
+
+void range_max_free(RangeMax *rmq) {
+    free(rmq->owned);
+    if (rmq->map) {
+        munmap(rmq->map, rmq->map_size);
+    }
+    memset(rmq, 0, sizeof(*rmq));
+}
@@ -0,0 +1,56 @@
+#ifndef RANGE_MAX_H
+#define RANGE_MAX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Range-max queries over per-line results: the largest max byte among lines
+// first..last, in O(1) per query.
+//
+// Lines are grouped into blocks of RANGE_MAX_BLOCK. A sparse table over the
+// block maxima answers the whole blocks inside a query with two lookups,
+// and the partial blocks at either end are scanned directly (at most
+// 2 * RANGE_MAX_BLOCK bytes, a few vector instructions). The table takes
+// (n / RANGE_MAX_BLOCK) * log2(n / RANGE_MAX_BLOCK) bytes, a small fraction
+// of the results themselves.
+//
+// The structure can be saved next to a result file ("results.rmq") and
+// mapped back without rebuilding. Layout (host byte order):
+//   header   magic "MAXR", uint32 version, uint64 line count,
+//            uint32 block size, uint32 levels, uint64 block count
+//   values   one max byte per line
+//   table    levels rows of block-count bytes; row j, entry i is the max
+//            of blocks i..i + 2^j - 1
+
+#define RANGE_MAX_MAGIC "MAXR"
+#define RANGE_MAX_VERSION 1
+#define RANGE_MAX_BLOCK 64
+
+typedef struct {
+    uint64_t num_lines;
+    const uint8_t *values;   // Per-line maxima
+    uint64_t num_blocks;
+    int levels;
+    const uint8_t *table;    // levels * num_blocks bytes
+    uint8_t *owned;          // Built in memory: values copy and table
+    void *map;               // Loaded: the mapped file
+    size_t map_size;
+} RangeMax;
+
+// Build the structure over a copy of values[0..num_lines). Returns 0 or -1.
+int range_max_build(RangeMax *rmq, const uint8_t *values, uint64_t num_lines);
+
+// Max of lines first..last inclusive; the caller checks
+// first <= last < num_lines
+uint8_t range_max_query(const RangeMax *rmq, uint64_t first, uint64_t last);
+
+// Save to path, or map a saved structure. Return 0 or -1.
+int range_max_save(const RangeMax *rmq, const char *path);
+int range_max_load(RangeMax *rmq, const char *path);
+
+// 1 if the first bytes of a file are a saved structure's magic
+int range_max_is_saved(const uint8_t *head, size_t len);
+
+void range_max_free(RangeMax *rmq);
+
+#endif
@@ -0,0 +1,188 @@
+#include "result_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define PRIME1 0x9E3779B97F4A7C15ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t block_bytes;
+    uint64_t file_size;
+    uint64_t num_blocks;
+    uint64_t num_lines;
+} CacheHeader;
+
+static inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t mix(uint64_t acc, uint64_t word) {
+    return rotl(acc ^ (word * PRIME2), 31) * PRIME1;
+}
+
+// Four independent lanes over 32-byte stripes keep several multiplies in
+// flight, so hashing is limited by memory rather than multiply latency
+uint64_t cache_hash(const char *data, size_t len) {
+    uint64_t lane[4] = {PRIME1, PRIME2, ~PRIME1, ~PRIME2};
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        uint64_t w[4];
+        memcpy(w, data + i, sizeof(w));
+        lane[0] = mix(lane[0], w[0]);
+        lane[1] = mix(lane[1], w[1]);
+        lane[2] = mix(lane[2], w[2]);
+        lane[3] = mix(lane[3], w[3]);
+    }
+    uint64_t h = rotl(lane[0], 1) + rotl(lane[1], 7) + rotl(lane[2], 12) + rotl(lane[3], 18);
+    h = mix(h, len);
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, data + i, sizeof(w));
+        h = mix(h, w);
+    }
+    for (; i < len; i++) {
+        h = mix(h, (unsigned char)data[i]);
+    }
+
+    // Final avalanche (SplitMix64 finaliser)
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+// Fill in each block's index into the results array
+static int index_blocks(ResultCache *cache) {
+    cache->first_line = malloc((cache->num_blocks ? cache->num_blocks : 1) * sizeof(uint64_t));
+    if (!cache->first_line) {
+        perror("Result cache allocation failed");
+        return -1;
+    }
+    uint64_t line = 0;
+    for (size_t k = 0; k < cache->num_blocks; k++) {
+        cache->first_line[k] = line;
+        line += cache->blocks[k].num_lines;
+    }
+    return 0;
+}
+
+int result_cache_load(ResultCache *cache, const char *path, uint64_t block_bytes) {
+    memset(cache, 0, sizeof(*cache));
+    cache->block_bytes = block_bytes;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return index_blocks(cache);
+    }
+    CacheHeader header;
+    int valid = fread(&header, sizeof(header), 1, f) == 1 &&
+                memcmp(header.magic, RESULT_CACHE_MAGIC, 4) == 0 &&
+                header.version == RESULT_CACHE_VERSION &&
+                header.block_bytes == block_bytes;
+    // The counts come from the file, so they must account for its exact
+    // size before they size any allocation
+    struct stat st;
+    if (valid) {
+        uint64_t body = 0;
+        valid = fstat(fileno(f), &st) == 0 && (uint64_t)st.st_size >= sizeof(header);
+        if (valid) {
+            body = (uint64_t)st.st_size - sizeof(header);
+        }
+        valid = valid && header.num_blocks <= body / sizeof(CacheBlock) &&
+                header.num_lines == body - header.num_blocks * sizeof(CacheBlock);
+    }
+    if (valid) {
+        cache->blocks = malloc((header.num_blocks ? header.num_blocks : 1) * sizeof(CacheBlock));
+        cache->results = malloc(header.num_lines ? header.num_lines : 1);
+        if (!cache->blocks || !cache->results) {
+            perror("Result cache allocation failed");
+            fclose(f);
+            result_cache_free(cache);
+            return -1;
+        }
+        valid = fread(cache->blocks, sizeof(CacheBlock), header.num_blocks, f) == header.num_blocks &&
+                fread(cache->results, 1, header.num_lines, f) == header.num_lines;
+    }
+    fclose(f);
+
+    uint64_t lines = 0;
+    for (size_t k = 0; valid && k < header.num_blocks; k++) {
+        lines += cache->blocks[k].num_lines;
+    }
+    if (!valid || lines != header.num_lines) {
+        // Stale or damaged: start from nothing
+        fprintf(stderr, "Ignoring unusable result cache %s\n", path);
+        result_cache_free(cache);
+        cache->block_bytes = block_bytes;
+        return index_blocks(cache);
+    }
+    cache->file_size = header.file_size;
+    cache->num_blocks = header.num_blocks;
+    cache->num_lines = header.num_lines;
+    return index_blocks(cache);
+}
+
+const CacheBlock *result_cache_match(const ResultCache *cache, size_t k, uint64_t offset,
+                                     uint64_t length, uint64_t hash) {
+    if (k >= cache->num_blocks) {
+        return NULL;
+    }
+    const CacheBlock *block = &cache->blocks[k];
+    if (block->offset != offset || block->length != length || block->hash != hash) {
+        return NULL;
+    }
+    return block;
+}
+
+int result_cache_save(const ResultCache *cache, const char *path) {
+    size_t tmp_len = strlen(path) + 5;
+    char *tmp = malloc(tmp_len);
+    if (!tmp) {
+        perror("Result cache allocation failed");
+        return -1;
+    }
+    snprintf(tmp, tmp_len, "%s.tmp", path);
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        perror("Error creating result cache");
+        free(tmp);
+        return -1;
+    }
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RESULT_CACHE_MAGIC, 4);
+    header.version = RESULT_CACHE_VERSION;
+    header.block_bytes = cache->block_bytes;
+    header.file_size = cache->file_size;
+    header.num_blocks = cache->num_blocks;
+    header.num_lines = cache->num_lines;
+
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(cache->blocks, sizeof(CacheBlock), cache->num_blocks, f) == cache->num_blocks &&
+             fwrite(cache->results, 1, cache->num_lines, f) == cache->num_lines;
+    if (fclose(f) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(tmp, path) != 0) {
+        perror("Error writing result cache");
+        remove(tmp);
+        free(tmp);
+        return -1;
+    }
+    free(tmp);
+    return 0;
+}
+
+void result_cache_free(ResultCache *cache) {
+    free(cache->blocks);
+    free(cache->results);
+    free(cache->first_line);
+    memset(cache, 0, sizeof(*cache));
+}
@@ -0,0 +1,64 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sidecar cache of per-line maxima, for incremental re-runs.
+//
+// The input is cut into blocks of whole lines: block k holds the lines
+// that start in bytes [k * block_bytes, (k + 1) * block_bytes). Where a
+// block ends depends only on the text up to the first newline past its
+// nominal end, so appending to a file leaves every earlier block's range
+// unchanged except the last one (whose final line or range grows). The
+// cache records each block's range, a hash of its bytes and its maxima; a
+// block whose range and hash still match is spliced from the cache instead
+// of being rescanned.
+//
+// File layout (host byte order; the cache is a local artefact):
+//   header   magic "MAXC", uint32 version, uint64 block_bytes,
+//            uint64 file size, uint64 block count, uint64 line count
+//   blocks   per block: uint64 offset, length, hash, line count
+//   results  one byte per line, all blocks in file order
+
+#define RESULT_CACHE_MAGIC "MAXC"
+#define RESULT_CACHE_VERSION 1
+#define RESULT_CACHE_BLOCK_BYTES (8u << 20)  // 8MB of text per block
+
+typedef struct {
+    uint64_t offset;     // First byte of the block's first line
+    uint64_t length;     // Bytes up to the start of the next block
+    uint64_t hash;       // cache_hash of those bytes
+    uint64_t num_lines;
+} CacheBlock;
+
+typedef struct {
+    uint64_t block_bytes;
+    uint64_t file_size;
+    size_t num_blocks;
+    CacheBlock *blocks;
+    uint64_t num_lines;
+    uint8_t *results;      // num_lines maxima
+    uint64_t *first_line;  // Index into results of each block's first line
+} ResultCache;
+
+// Hash of len bytes, fast enough to run near memory bandwidth
+uint64_t cache_hash(const char *data, size_t len);
+
+// Load the cache at path. A missing, truncated or foreign file (other
+// version or block size) loads as an empty cache, so the run simply
+// recomputes everything. Returns -1 only on allocation failure.
+int result_cache_load(ResultCache *cache, const char *path, uint64_t block_bytes);
+
+// Block k of the cache if it still describes [offset, offset + length)
+// with the given hash, otherwise NULL
+const CacheBlock *result_cache_match(const ResultCache *cache, size_t k, uint64_t offset,
+                                     uint64_t length, uint64_t hash);
+
+// Write a cache to path through a temporary file and rename, so a crashed
+// run never leaves a half-written cache behind. Returns 0 or -1.
+int result_cache_save(const ResultCache *cache, const char *path);
+
+void result_cache_free(ResultCache *cache);
+
+#endif
@@ -0,0 +1,285 @@
+#include "result_format.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+char *format_u64(char *dst, uint64_t value) {
+    // Emit two digits at a time from the right into a scratch buffer
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        p[0] = digit_pairs[pair];
+        p[1] = digit_pairs[pair + 1];
+    }
+    if (value >= 10) {
+        p -= 2;
+        p[0] = digit_pairs[value * 2];
+        p[1] = digit_pairs[value * 2 + 1];
+    } else {
+        *--p = (char)('0' + value);
+    }
+    size_t n = (size_t)(tmp + sizeof(tmp) - p);
+    memcpy(dst, p, n);
+    return dst + n;
+}
+
+// Max values are 0..255, so the value column is at most three digits
+static inline char *format_byte(char *dst, unsigned value) {
+    if (value >= 100) {
+        *dst++ = (char)('0' + value / 100);
+        value %= 100;
+        *dst++ = digit_pairs[value * 2];
+        *dst++ = digit_pairs[value * 2 + 1];
+    } else if (value >= 10) {
+        *dst++ = digit_pairs[value * 2];
+        *dst++ = digit_pairs[value * 2 + 1];
+    } else {
+        *dst++ = (char)('0' + value);
+    }
+    return dst;
+}
+
+size_t format_results(char *dst, uint64_t first_line, const uint8_t *results, size_t count) {
+    char *p = dst;
+    for (size_t i = 0; i < count; i++) {
+        p = format_u64(p, first_line + i);
+        *p++ = ':';
+        *p++ = ' ';
+        p = format_byte(p, results[i]);
+        *p++ = '\n';
+    }
+    return (size_t)(p - dst);
+}
+
+int parse_metrics(const char *list, unsigned *metrics) {
+    static const struct {
+        const char *name;
+        unsigned bit;
+    } names[] = {
+        {"max", METRIC_MAX},       {"min", METRIC_MIN},           {"len", METRIC_LENGTH},
+        {"nonascii", METRIC_NON_ASCII}, {"ctrl", METRIC_CONTROL},
+        {"cp", METRIC_CODEPOINT},       {"invalid", METRIC_INVALID},
+    };
+    unsigned mask = 0;
+    const char *p = list;
+    for (;;) {
+        size_t len = strcspn(p, ",");
+        size_t k = 0;
+        while (k < sizeof(names) / sizeof(names[0]) &&
+               (strlen(names[k].name) != len || strncmp(names[k].name, p, len) != 0)) {
+            k++;
+        }
+        if (k == sizeof(names) / sizeof(names[0])) {
+            return -1;
+        }
+        mask |= names[k].bit;
+        if (p[len] == '\0') {
+            break;
+        }
+        p += len + 1;
+    }
+    *metrics = mask;
+    return 0;
+}
+
+size_t metric_size_bound(unsigned metrics, size_t count) {
+    // Index and ": ", then a space-terminated column per metric; the last
+    // separator becomes the newline
+    size_t row = 22;
+    row += (metrics & METRIC_MAX) ? 4 : 0;
+    row += (metrics & METRIC_MIN) ? 4 : 0;
+    row += (metrics & METRIC_LENGTH) ? 21 : 0;
+    row += (metrics & METRIC_NON_ASCII) ? 21 : 0;
+    row += (metrics & METRIC_CONTROL) ? 2 : 0;
+    row += (metrics & METRIC_CODEPOINT) ? 8 : 0;
+    row += (metrics & METRIC_INVALID) ? 2 : 0;
+    return count * row;
+}
+
+size_t format_metrics(char *dst, unsigned metrics, uint64_t first_line, const LineStats *stats,
+                      size_t count) {
+    char *p = dst;
+    for (size_t i = 0; i < count; i++) {
+        const LineStats *s = &stats[i];
+        p = format_u64(p, first_line + i);
+        *p++ = ':';
+        if (metrics & METRIC_MAX) {
+            *p++ = ' ';
+            p = format_byte(p, s->max);
+        }
+        if (metrics & METRIC_MIN) {
+            *p++ = ' ';
+            p = format_byte(p, s->min);
+        }
+        if (metrics & METRIC_LENGTH) {
+            *p++ = ' ';
+            p = format_u64(p, s->length);
+        }
+        if (metrics & METRIC_NON_ASCII) {
+            *p++ = ' ';
+            p = format_u64(p, s->non_ascii);
+        }
+        if (metrics & METRIC_CONTROL) {
+            *p++ = ' ';
+            *p++ = (char)('0' + s->control);
+        }
+        if (metrics & METRIC_CODEPOINT) {
+            *p++ = ' ';
+            p = format_u64(p, s->codepoint);
+        }
+        if (metrics & METRIC_INVALID) {
+            *p++ = ' ';
+            *p++ = (char)('0' + s->invalid);
+        }
+        *p++ = '\n';
+    }
+    return (size_t)(p - dst);
+}
+
+int parse_output_format(const char *name, OutputFormat *format) {
+    if (strcmp(name, "text") == 0) {
+        *format = OUTPUT_TEXT;
+    } else if (strcmp(name, "bin") == 0 || strcmp(name, "binary") == 0) {
+        *format = OUTPUT_BINARY;
+    } else if (strcmp(name, "rle") == 0) {
+        *format = OUTPUT_RLE;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+size_t encode_rle(uint8_t *dst, const uint8_t *results, size_t count) {
+    uint8_t *p = dst;
+    size_t i = 0;
+    while (i < count) {
+        uint8_t value = results[i];
+        size_t run = 1;
+        while (i + run < count && results[i + run] == value) {
+            run++;
+        }
+        *p++ = value;
+        // LEB128: seven bits per byte, high bit set on all but the last
+        uint64_t n = run;
+        while (n >= 0x80) {
+            *p++ = (uint8_t)(n | 0x80);
+            n >>= 7;
+        }
+        *p++ = (uint8_t)n;
+        i += run;
+    }
+    return (size_t)(p - dst);
+}
+
+size_t encoded_size_bound(OutputFormat format, size_t count) {
+    switch (format) {
+    case OUTPUT_BINARY:
+        return count;
+    case OUTPUT_RLE:
+        return 2 * count;  // A run of n costs at most 1 + varint(n) <= 2n bytes
+    case OUTPUT_TEXT:
+    default:
+        return count * RESULT_ROW_MAX;
+    }
+}
+
+size_t encode_results(OutputFormat format, char *dst, uint64_t first_line,
+                      const uint8_t *results, size_t count) {
+    switch (format) {
+    case OUTPUT_BINARY:
+        memcpy(dst, results, count);
+        return count;
+    case OUTPUT_RLE:
+        return encode_rle((uint8_t *)dst, results, count);
+    case OUTPUT_TEXT:
+    default:
+        return format_results(dst, first_line, results, count);
+    }
+}
+
+void encode_header(uint8_t *dst, OutputFormat format, uint64_t num_lines) {
+    memcpy(dst, RESULT_MAGIC, 4);
+    dst[4] = RESULT_VERSION;
+    dst[5] = (uint8_t)format;
+    dst[6] = 0;
+    dst[7] = 0;
+    for (int i = 0; i < 8; i++) {
+        dst[8 + i] = (uint8_t)(num_lines >> (8 * i));
+    }
+}
+
+int decode_header(const uint8_t *src, OutputFormat *format, uint64_t *num_lines) {
+    if (memcmp(src, RESULT_MAGIC, 4) != 0 || src[4] != RESULT_VERSION) {
+        return -1;
+    }
+    if (src[5] != OUTPUT_BINARY && src[5] != OUTPUT_RLE) {
+        return -1;
+    }
+    *format = (OutputFormat)src[5];
+    uint64_t n = 0;
+    for (int i = 0; i < 8; i++) {
+        n |= (uint64_t)src[8 + i] << (8 * i);
+    }
+    *num_lines = n;
+    return 0;
+}
+
+int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int writev_all(int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        int batch = (iovcnt > IOV_MAX) ? IOV_MAX : iovcnt;
+        ssize_t n = writev(fd, iov, batch);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        // Skip fully written buffers, then trim the partially written one
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#ifndef RESULT_FORMAT_H
+#define RESULT_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "ascii_kernel.h"
+
+// Result output shared by all backends. Each thread (or rank) encodes its
+// own contiguous slice of the per-line maxima into a private buffer, and
+// the slices are then written in order with as few system calls as
+// possible. Every encoding can be produced slice by slice and the slices
+// simply concatenated.
+//
+// Formats:
+//   text    one "<line>: <max>\n" row per line (the original output)
+//   binary  header + one uint8_t per line
+//   rle     header + runs of (uint8_t value, LEB128 varint run length)
+//
+// The 16-byte header of the binary formats is
+//   bytes 0-3   magic "MAXA"
+//   byte  4     version (1)
+//   byte  5     encoding (1 = binary, 2 = rle)
+//   bytes 6-7   reserved, zero
+//   bytes 8-15  line count, little-endian (all ones if unknown when
+//               written; the reader then decodes to end of file)
+
+typedef enum {
+    OUTPUT_TEXT = 0,
+    OUTPUT_BINARY = 1,
+    OUTPUT_RLE = 2
+} OutputFormat;
+
+#define RESULT_MAGIC "MAXA"
+#define RESULT_VERSION 1
+#define RESULT_HEADER_SIZE 16
+#define RESULT_COUNT_UNKNOWN UINT64_MAX
+
+// Upper bound on one text row: 20-digit index, ": ", 3-digit value, '\n'
+#define RESULT_ROW_MAX 26
+
+// Parse "text", "bin"/"binary" or "rle". Returns 0, or -1 if unknown.
+int parse_output_format(const char *name, OutputFormat *format);
+
+// Write the decimal form of value at dst; returns the end of the digits
+char *format_u64(char *dst, uint64_t value);
+
+// Format count text rows starting at line number first_line into dst,
+// which must hold count * RESULT_ROW_MAX bytes. Returns the bytes written.
+size_t format_results(char *dst, uint64_t first_line, const uint8_t *results, size_t count);
+
+// Run-length encode count results into dst, which must hold 2 * count
+// bytes. Returns the bytes written.
+size_t encode_rle(uint8_t *dst, const uint8_t *results, size_t count);
+
+// Largest encoded size of a slice of count results
+size_t encoded_size_bound(OutputFormat format, size_t count);
+
+// Encode one slice in the given format (first_line only matters for
+// text). Returns the bytes written.
+size_t encode_results(OutputFormat format, char *dst, uint64_t first_line,
+                      const uint8_t *results, size_t count);
+
+// Per-line metrics (maxascii -m). Text rows then carry one column per
+// selected metric, always in this order:
+// "<line>: max min len nonascii ctrl cp invalid"
+enum {
+    METRIC_MAX = 1 << 0,       // Largest byte
+    METRIC_MIN = 1 << 1,       // Smallest byte
+    METRIC_LENGTH = 1 << 2,    // Bytes, newline excluded
+    METRIC_NON_ASCII = 1 << 3, // Bytes above 127
+    METRIC_CONTROL = 1 << 4,   // 1 if any control byte, else 0
+    METRIC_CODEPOINT = 1 << 5, // Largest UTF-8 codepoint, in decimal
+    METRIC_INVALID = 1 << 6    // 1 if not well-formed UTF-8, else 0
+};
+
+// Metrics that come from the byte statistics pass, and from UTF-8 decoding
+#define METRIC_BYTE_STATS (METRIC_MAX | METRIC_MIN | METRIC_LENGTH | METRIC_NON_ASCII | METRIC_CONTROL)
+#define METRIC_UTF8 (METRIC_CODEPOINT | METRIC_INVALID)
+
+// Parse comma-separated max, min, len, nonascii, ctrl, cp and invalid into
+// a METRIC_* mask. Returns 0, or -1 on an unknown or empty name.
+int parse_metrics(const char *list, unsigned *metrics);
+
+// Largest text size of a slice of count metric rows
+size_t metric_size_bound(unsigned metrics, size_t count);
+
+// Format count metric rows starting at line number first_line. Returns
+// the bytes written.
+size_t format_metrics(char *dst, unsigned metrics, uint64_t first_line, const LineStats *stats,
+                      size_t count);
+
+// Fill the RESULT_HEADER_SIZE-byte header for a binary format
+void encode_header(uint8_t *dst, OutputFormat format, uint64_t num_lines);
+
+// Parse a header. Returns 0 with *format and *num_lines set, or -1 if the
+// bytes are not a result header this version understands.
+int decode_header(const uint8_t *src, OutputFormat *format, uint64_t *num_lines);
+
+// Write the whole buffer, retrying short writes. Returns 0 or -1.
+int write_all(int fd, const char *buf, size_t len);
+
+// Write all iovcnt buffers in order, batching IOV_MAX at a time and
+// retrying short writes. iov is modified. Returns 0 or -1.
+int writev_all(int fd, struct iovec *iov, int iovcnt);
+
+#endif
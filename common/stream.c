@@ -0,0 +1,451 @@
+#define _GNU_SOURCE  // memrchr
+
+#include "stream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "affinity.h"
+#include "ascii_kernel.h"
+#include "compressed_input.h"
+#include "result_format.h"
+
+#define STREAM_BLOCK_SIZE (1 << 20)  // 1MB of text per block
+#define BLOCKS_PER_WORKER 2          // Ring depth, so the reader stays ahead
+
+enum {
+    BLOCK_FREE,     // Owned by the reader
+    BLOCK_FILLED,   // Holds whole lines, waiting for a worker
+    BLOCK_CLAIMED,  // Being processed
+    BLOCK_DONE      // Results ready, waiting for the writer
+};
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    uint8_t *results;
+    size_t num_lines;
+    size_t results_cap;
+    uint64_t first_line;  // Global index of the block's first line
+    char *text;           // Encoded results, written as-is by the writer
+    size_t text_len;
+    size_t text_cap;
+    int state;
+} StreamBlock;
+
+typedef struct {
+    StreamBlock *blocks;
+    size_t num_blocks;
+    int fd;
+    const char *filename;
+    OutputFormat format;
+    const CpuPlacement *placement;
+    int next_worker;            // Placement slot of the next worker to start
+
+    pthread_mutex_t lock;
+    pthread_cond_t slot_free;   // Writer released a block
+    pthread_cond_t block_ready; // Reader published a block (or finished)
+    pthread_cond_t block_done;  // Worker finished a block (or reader finished)
+
+    // Monotonic block sequence numbers; block n lives in slot n % num_blocks
+    size_t next_fill;
+    size_t next_claim;
+    size_t next_write;
+    int reader_done;
+    int error;
+} Stream;
+
+// Make sure a block can hold need bytes, keeping its current contents
+static int reserve_block(StreamBlock *block, size_t need) {
+    if (block->cap >= need) {
+        return 0;
+    }
+    size_t cap = block->cap ? block->cap : STREAM_BLOCK_SIZE;
+    while (cap < need) {
+        cap *= 2;
+    }
+    char *grown = realloc(block->data, cap);
+    if (!grown) {
+        return -1;
+    }
+    block->data = grown;
+    block->cap = cap;
+    return 0;
+}
+
+// Read until the block holds at least target bytes or the input ends.
+// Returns 1 at end of input, 0 otherwise, -1 on a read error.
+static int fill_block(int fd, StreamBlock *block, size_t target) {
+    while (block->len < target) {
+        ssize_t got = read(fd, block->data + block->len, target - block->len);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error reading input");
+            return -1;
+        }
+        if (got == 0) {
+            return 1;
+        }
+        block->len += (size_t)got;
+    }
+    return 0;
+}
+
+// Number of lines in a block of whole lines (only the last may lack '\n')
+static uint64_t count_lines(const char *data, size_t len) {
+    uint64_t lines = 0;
+    const char *p = data;
+    const char *end = data + len;
+    while ((p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        lines++;
+        p++;
+    }
+    if (len > 0 && data[len - 1] != '\n') {
+        lines++;
+    }
+    return lines;
+}
+
+// The ring holds raw bytes, so compressed dumps must take the mapped path.
+// Returns -1 (after saying so) if the input starts like gzip or zstd.
+static int refuse_compressed(const char *filename, const void *data, size_t len) {
+    Compression kind = compression_detect(data, len);
+    if (kind == COMPRESSION_NONE) {
+        return 0;
+    }
+    fprintf(stderr, "Error: %s is %s-compressed; run without -s\n", filename,
+            compression_name(kind));
+    return -1;
+}
+
+static void finish_reader(Stream *s, int error) {
+    pthread_mutex_lock(&s->lock);
+    s->reader_done = 1;
+    s->error |= error;
+    pthread_cond_broadcast(&s->block_ready);
+    pthread_cond_broadcast(&s->block_done);
+    pthread_mutex_unlock(&s->lock);
+}
+
+// Reader thread: fill free slots in order. A block is cut after its last
+// newline and the partial line is carried to the front of the next block;
+// a block without any newline is grown until its line is complete.
+static void *reader_thread(void *arg) {
+    Stream *s = (Stream *)arg;
+    char *carry = NULL;
+    size_t carry_len = 0;
+    size_t carry_cap = 0;
+    uint64_t next_line = 0;
+    int eof = 0;
+
+    for (size_t seq = 0; !eof; seq++) {
+        StreamBlock *block = &s->blocks[seq % s->num_blocks];
+
+        pthread_mutex_lock(&s->lock);
+        while (block->state != BLOCK_FREE && !s->error) {
+            pthread_cond_wait(&s->slot_free, &s->lock);
+        }
+        int stop = s->error;
+        pthread_mutex_unlock(&s->lock);
+        if (stop) {
+            break;
+        }
+
+        size_t target = carry_len + STREAM_BLOCK_SIZE;
+        if (reserve_block(block, target) != 0) {
+            perror("Stream block allocation failed");
+            free(carry);
+            finish_reader(s, 1);
+            return NULL;
+        }
+        memcpy(block->data, carry, carry_len);
+        block->len = carry_len;
+        carry_len = 0;
+
+        for (;;) {
+            int rc = fill_block(s->fd, block, target);
+            if (rc < 0) {
+                free(carry);
+                finish_reader(s, 1);
+                return NULL;
+            }
+            if (rc == 1) {
+                eof = 1;  // Whatever is left is the final line
+                break;
+            }
+            const char *nl = memrchr(block->data, '\n', block->len);
+            if (nl) {
+                size_t keep = (size_t)(nl - block->data) + 1;
+                carry_len = block->len - keep;
+                if (carry_len > carry_cap) {
+                    char *grown = realloc(carry, carry_len);
+                    if (!grown) {
+                        perror("Stream carry allocation failed");
+                        free(carry);
+                        finish_reader(s, 1);
+                        return NULL;
+                    }
+                    carry = grown;
+                    carry_cap = carry_len;
+                }
+                memcpy(carry, block->data + keep, carry_len);
+                block->len = keep;
+                break;
+            }
+            // One line longer than the block: grow it and keep reading
+            target = block->cap * 2;
+            if (reserve_block(block, target) != 0) {
+                perror("Stream block allocation failed");
+                free(carry);
+                finish_reader(s, 1);
+                return NULL;
+            }
+        }
+
+        if (block->len == 0) {
+            break;  // Input ended exactly on a block boundary
+        }
+        // Named files were checked before starting; a pipe shows its
+        // magic bytes only now
+        if (seq == 0 && refuse_compressed(s->filename, block->data, block->len) != 0) {
+            free(carry);
+            finish_reader(s, 1);
+            return NULL;
+        }
+
+        // Numbering blocks here lets workers format their rows right away
+        // instead of waiting for every earlier block to finish
+        block->first_line = next_line;
+        next_line += count_lines(block->data, block->len);
+
+        pthread_mutex_lock(&s->lock);
+        block->state = BLOCK_FILLED;
+        s->next_fill = seq + 1;
+        pthread_cond_signal(&s->block_ready);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    free(carry);
+    finish_reader(s, 0);
+    return NULL;
+}
+
+// Compute the max of every line in a block and encode its output
+static int process_block(StreamBlock *block, OutputFormat format) {
+    block->num_lines = 0;
+    size_t pos = 0;
+    while (pos < block->len) {
+        if (block->num_lines == block->results_cap) {
+            size_t cap = block->results_cap ? block->results_cap * 2 : 4096;
+            uint8_t *grown = realloc(block->results, cap);
+            if (!grown) {
+                perror("Stream result allocation failed");
+                return -1;
+            }
+            block->results = grown;
+            block->results_cap = cap;
+        }
+        int max_value;
+        size_t line_len = collect_ascii_line(block->data + pos, block->len - pos, &max_value);
+        block->results[block->num_lines++] = max_value;
+        pos += line_len + 1;
+    }
+
+    size_t need = encoded_size_bound(format, block->num_lines);
+    if (need > block->text_cap) {
+        char *grown = realloc(block->text, need);
+        if (!grown) {
+            perror("Stream output allocation failed");
+            return -1;
+        }
+        block->text = grown;
+        block->text_cap = need;
+    }
+    block->text_len = encode_results(format, block->text, block->first_line,
+                                     block->results, block->num_lines);
+    return 0;
+}
+
+// Worker thread: claim filled blocks in order until the reader is done
+static void *worker_thread(void *arg) {
+    Stream *s = (Stream *)arg;
+
+    pthread_mutex_lock(&s->lock);
+    int slot = s->next_worker++;
+    pthread_mutex_unlock(&s->lock);
+    cpu_placement_pin_self(s->placement, slot);
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        while (s->next_claim == s->next_fill && !s->reader_done && !s->error) {
+            pthread_cond_wait(&s->block_ready, &s->lock);
+        }
+        if (s->error || s->next_claim == s->next_fill) {
+            break;
+        }
+        StreamBlock *block = &s->blocks[s->next_claim % s->num_blocks];
+        s->next_claim++;
+        block->state = BLOCK_CLAIMED;
+        pthread_mutex_unlock(&s->lock);
+
+        int rc = process_block(block, s->format);
+
+        pthread_mutex_lock(&s->lock);
+        if (rc != 0) {
+            s->error = 1;
+            pthread_cond_broadcast(&s->slot_free);
+            pthread_cond_broadcast(&s->block_ready);
+        }
+        block->state = BLOCK_DONE;
+        pthread_cond_broadcast(&s->block_done);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+// A failed write stops the reader and workers like any other stream error
+static void fail_writer(Stream *s) {
+    pthread_mutex_lock(&s->lock);
+    s->error = 1;
+    pthread_cond_broadcast(&s->slot_free);
+    pthread_cond_broadcast(&s->block_ready);
+    pthread_mutex_unlock(&s->lock);
+}
+
+long long stream_process(const char *filename, int num_workers, const CpuPlacement *placement,
+                         OutputFormat format, FILE *out) {
+    Stream s;
+    memset(&s, 0, sizeof(s));
+    s.format = format;
+    s.placement = placement;
+    s.filename = filename;
+
+    if (strcmp(filename, "-") == 0) {
+        s.fd = STDIN_FILENO;
+    } else {
+        Compression kind = compression_of_file(filename);
+        if (kind != COMPRESSION_NONE) {
+            fprintf(stderr, "Error: %s is %s-compressed; run without -s\n", filename,
+                    compression_name(kind));
+            return -1;
+        }
+        s.fd = open(filename, O_RDONLY);
+        if (s.fd < 0) {
+            perror("Error opening file");
+            return -1;
+        }
+        posix_fadvise(s.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    s.num_blocks = (size_t)num_workers * BLOCKS_PER_WORKER;
+    s.blocks = calloc(s.num_blocks, sizeof(StreamBlock));
+    pthread_t *workers = malloc(num_workers * sizeof(pthread_t));
+    if (!s.blocks || !workers) {
+        perror("Stream allocation failed");
+        free(s.blocks);
+        free(workers);
+        if (s.fd != STDIN_FILENO) {
+            close(s.fd);
+        }
+        return -1;
+    }
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.slot_free, NULL);
+    pthread_cond_init(&s.block_ready, NULL);
+    pthread_cond_init(&s.block_done, NULL);
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, reader_thread, &s);
+    for (int i = 0; i < num_workers; i++) {
+        pthread_create(&workers[i], NULL, worker_thread, &s);
+    }
+
+    // Binary formats start with a header; the count is patched in at the end
+    uint8_t header[RESULT_HEADER_SIZE];
+    off_t header_pos = -1;
+    if (format != OUTPUT_TEXT) {
+        fflush(out);
+        header_pos = lseek(fileno(out), 0, SEEK_CUR);
+        encode_header(header, format, RESULT_COUNT_UNKNOWN);
+        if (fwrite(header, 1, RESULT_HEADER_SIZE, out) != RESULT_HEADER_SIZE) {
+            fail_writer(&s);
+        }
+    }
+
+    // Ordered writer: emit block n only after blocks 0..n-1 are written
+    long long line = 0;
+    pthread_mutex_lock(&s.lock);
+    for (;;) {
+        StreamBlock *block = &s.blocks[s.next_write % s.num_blocks];
+        while (!s.error && !(s.next_write < s.next_fill && block->state == BLOCK_DONE) &&
+               !(s.reader_done && s.next_write == s.next_fill)) {
+            pthread_cond_wait(&s.block_done, &s.lock);
+        }
+        if (s.error || s.next_write == s.next_fill) {
+            break;
+        }
+        pthread_mutex_unlock(&s.lock);
+
+        int written = fwrite(block->text, 1, block->text_len, out) == block->text_len;
+        line += block->num_lines;
+
+        pthread_mutex_lock(&s.lock);
+        if (!written) {
+            s.error = 1;
+            break;
+        }
+        block->state = BLOCK_FREE;
+        s.next_write++;
+        pthread_cond_signal(&s.slot_free);
+    }
+    int error = s.error;
+    pthread_cond_broadcast(&s.slot_free);
+    pthread_cond_broadcast(&s.block_ready);
+    pthread_mutex_unlock(&s.lock);
+
+    pthread_join(reader, NULL);
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    for (size_t i = 0; i < s.num_blocks; i++) {
+        free(s.blocks[i].data);
+        free(s.blocks[i].results);
+        free(s.blocks[i].text);
+    }
+    free(s.blocks);
+    free(workers);
+    pthread_mutex_destroy(&s.lock);
+    pthread_cond_destroy(&s.slot_free);
+    pthread_cond_destroy(&s.block_ready);
+    pthread_cond_destroy(&s.block_done);
+    if (s.fd != STDIN_FILENO) {
+        close(s.fd);
+    }
+
+    if (!error && (fflush(out) != 0 || ferror(out))) {
+        error = 1;
+    }
+    if (error && ferror(out)) {
+        perror("Error writing results");
+    }
+
+    // Pipes cannot seek back; readers then decode to end of input
+    if (!error && header_pos >= 0) {
+        encode_header(header, format, (uint64_t)line);
+        if (pwrite(fileno(out), header, RESULT_HEADER_SIZE, header_pos) != RESULT_HEADER_SIZE) {
+            perror("Error updating result header");
+            error = 1;
+        }
+    }
+
+    return error ? -1 : line;
+}
@@ -0,0 +1,26 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdio.h>
+
+#include "affinity.h"
+#include "result_format.h"
+
+// Bounded-memory streaming mode.
+//
+// A reader thread fills a fixed ring of large blocks, each holding whole
+// lines only. num_workers threads compute the per-line maxima of filled
+// blocks as they arrive, and the calling thread writes each block's
+// results to out in file order, encoded as format, as soon as it
+// completes. Peak memory is the ring (plus the longest single line),
+// independent of input size. Workers are pinned according to placement
+// (may be NULL); the reader and writer are left to the scheduler.
+//
+// The line count is not known until the end, so a binary header is
+// written with RESULT_COUNT_UNKNOWN and patched afterwards if out is
+// seekable. filename may be "-" to read standard input. Returns the
+// number of lines processed, or -1 on error.
+long long stream_process(const char *filename, int num_workers, const CpuPlacement *placement,
+                         OutputFormat format, FILE *out);
+
+#endif
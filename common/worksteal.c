@@ -0,0 +1,77 @@
+#include "worksteal.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PACK(head, tail) (((uint64_t)(head) << 32) | (uint32_t)(tail))
+#define HEAD(range) ((uint32_t)((range) >> 32))
+#define TAIL(range) ((uint32_t)(range))
+
+int ws_init(WorkScheduler *sched, size_t num_blocks, int num_threads) {
+    if (num_blocks > UINT32_MAX) {
+        fprintf(stderr, "Error: %zu work blocks exceeds the scheduler limit\n", num_blocks);
+        return -1;
+    }
+
+    sched->deques = aligned_alloc(64, num_threads * sizeof(WorkDeque));
+    if (!sched->deques) {
+        perror("Scheduler allocation failed");
+        return -1;
+    }
+    sched->num_threads = num_threads;
+
+    for (int i = 0; i < num_threads; i++) {
+        size_t head = num_blocks * i / num_threads;
+        size_t tail = num_blocks * (i + 1) / num_threads;
+        atomic_init(&sched->deques[i].range, PACK(head, tail));
+    }
+    return 0;
+}
+
+void ws_destroy(WorkScheduler *sched) {
+    free(sched->deques);
+    sched->deques = NULL;
+}
+
+// Owner side: take the block at the head
+static int take_head(WorkDeque *dq, size_t *block) {
+    uint64_t range = atomic_load_explicit(&dq->range, memory_order_relaxed);
+    while (HEAD(range) < TAIL(range)) {
+        uint64_t next = PACK(HEAD(range) + 1, TAIL(range));
+        if (atomic_compare_exchange_weak_explicit(&dq->range, &range, next,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            *block = HEAD(range);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Thief side: take the block at the tail, as far from the owner as possible
+static int take_tail(WorkDeque *dq, size_t *block) {
+    uint64_t range = atomic_load_explicit(&dq->range, memory_order_relaxed);
+    while (HEAD(range) < TAIL(range)) {
+        uint64_t next = PACK(HEAD(range), TAIL(range) - 1);
+        if (atomic_compare_exchange_weak_explicit(&dq->range, &range, next,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            *block = TAIL(range) - 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int ws_next(WorkScheduler *sched, int self, size_t *block) {
+    if (take_head(&sched->deques[self], block)) {
+        return 1;
+    }
+    // Walk the other deques starting with our neighbour so thieves spread out
+    for (int i = 1; i < sched->num_threads; i++) {
+        int victim = (self + i) % sched->num_threads;
+        if (take_tail(&sched->deques[victim], block)) {
+            return 1;
+        }
+    }
+    return 0;
+}
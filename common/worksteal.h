@@ -0,0 +1,33 @@
+#ifndef WORKSTEAL_H
+#define WORKSTEAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Chunked work-stealing scheduler over a fixed set of blocks 0..n-1.
+//
+// Every thread starts with a contiguous share of the blocks in its own
+// deque and takes work from the head. A thread whose deque runs dry steals
+// single blocks from the tail of the other deques, so a thread that drew
+// long lines is relieved by the others instead of holding up the join.
+// No work is ever added, so once every deque is empty the run is over.
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t range;  // head << 32 | tail, [head, tail) left
+} WorkDeque;
+
+typedef struct {
+    WorkDeque *deques;
+    int num_threads;
+} WorkScheduler;
+
+// Split num_blocks evenly over num_threads deques. Returns 0 on success.
+int ws_init(WorkScheduler *sched, size_t num_blocks, int num_threads);
+
+void ws_destroy(WorkScheduler *sched);
+
+// Get the next block for thread self, stealing if its own deque is empty.
+// Returns 1 with *block set, or 0 when all work has been handed out.
+int ws_next(WorkScheduler *sched, int self, size_t *block);
+
+#endif
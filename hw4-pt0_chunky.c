@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "splitmix64.h"
+
 #define NUM_THREADS 4
 
 #define ARRAY_SIZE 2000000
@@ -12,27 +14,36 @@
 char char_array[ARRAY_SIZE][STRING_SIZE];
 int char_counts[ALPHABET_SIZE];			// count of individual characters
 
-char getRandomChar()
+					// fill rows [first, last) of char_array
+void fill_rows(long first, long last)
 {
-	int randNum = 0;
-	char randChar = ' ';
-
-	randNum = ALPHABET_SIZE * (rand() / (RAND_MAX + 1.0)); 	// pick number 0 < # < 25
-	randNum = randNum + 97;				// scale to 'a'
-	randChar = (char) randNum;
-
-	// printf("%c", randChar);
-	return randChar;
+  long i;
+  int j, k;
+  unsigned long long draw[DRAWS_PER_ROW];
+
+  for ( i = first; i < last; i++ ) {
+					// independent draws, then a branch-free
+					// scale to 'a'..'z'; gcc -O3 vectorizes
+					// the row loop (-O2 does not)
+	for ( k = 0; k < DRAWS_PER_ROW; k++ ) {
+		draw[k] = mix64(RNG_SEED + RNG_GAMMA * (unsigned long long) (i * DRAWS_PER_ROW + k));
+	}
+	for ( j = 0; j < STRING_SIZE; j++ ) {
+		unsigned bits = (unsigned) (draw[j / 4] >> (16 * (j % 4))) & 0xffff;
+		char_array[i][j] = (char) (97 + ((bits * ALPHABET_SIZE) >> 16));
+	}
+  }
 }
 
 void init_arrays()
 {
-  int i, j; 
+  int i;
 
-  for ( i = 0; i < ARRAY_SIZE; i++) {
-	for ( j = 0; j < STRING_SIZE; j++ ) {
-		 char_array[i][j] = getRandomChar();
-	}
+					// one chunk of rows per NUM_THREADS slot,
+					// as count_array splits them; each could
+					// be generated by its own thread
+  for ( i = 0; i < NUM_THREADS; i++ ) {
+	fill_rows((long) i * ARRAY_SIZE / NUM_THREADS, (long) (i + 1) * ARRAY_SIZE / NUM_THREADS);
   }
 
   for ( i = 0; i < ALPHABET_SIZE; i++ ) {
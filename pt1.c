@@ -3,40 +3,68 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "splitmix64.h"
+
 #define NUM_THREADS 4
 
 #define ARRAY_SIZE 2000000
 #define STRING_SIZE 16
 #define ALPHABET_SIZE 26
+#define LANES 4				// interleaved sub-histograms per thread
+#define CACHE_LINE 64
+
+typedef struct {
+	int counts[ALPHABET_SIZE];
+} __attribute__((aligned(CACHE_LINE))) padded_count_t;	// no two threads share a cache line
 
-pthread_mutex_t mutexsum;			// mutex for char_counts
+pthread_barrier_t merge_barrier;		// one round of the tree merge
 
 char char_array[ARRAY_SIZE][STRING_SIZE];
+padded_count_t thread_counts[NUM_THREADS];	// each thread's partial counts
 int char_counts[ALPHABET_SIZE];			// count of individual characters
 
-char getRandomChar()
+					// fill rows [first, last) of char_array
+void fill_rows(long first, long last)
 {
-	int randNum = 0;
-	char randChar = ' ';
+  long i;
+  int j, k;
+  unsigned long long draw[DRAWS_PER_ROW];
+
+  for ( i = first; i < last; i++ ) {
+					// independent draws, then a branch-free
+					// scale to 'a'..'z'; gcc -O3 vectorizes
+					// the row loop (-O2 does not)
+	for ( k = 0; k < DRAWS_PER_ROW; k++ ) {
+		draw[k] = mix64(RNG_SEED + RNG_GAMMA * (unsigned long long) (i * DRAWS_PER_ROW + k));
+	}
+	for ( j = 0; j < STRING_SIZE; j++ ) {
+		unsigned bits = (unsigned) (draw[j / 4] >> (16 * (j % 4))) & 0xffff;
+		char_array[i][j] = (char) (97 + ((bits * ALPHABET_SIZE) >> 16));
+	}
+  }
+}
 
-	randNum = ALPHABET_SIZE * (rand() / (RAND_MAX + 1.0)); 	// pick number 0 < # < 25
-	randNum = randNum + 97;				// scale to 'a'
-	randChar = (char) randNum;
+void *fill_slice(void *myID)
+{
+  long id = (long) myID;
 
-	// printf("%c", randChar);
-	return randChar;
+  fill_rows(id * ARRAY_SIZE / NUM_THREADS, (id + 1) * ARRAY_SIZE / NUM_THREADS);
+  pthread_exit(NULL);
 }
 
 void init_arrays()
 {
-  int i, j; 
+  long i;
+  pthread_t threads[NUM_THREADS];
 
-  pthread_mutex_init(&mutexsum, NULL);
+  pthread_barrier_init(&merge_barrier, NULL, NUM_THREADS);
 
-  for ( i = 0; i < ARRAY_SIZE; i++) {
-	for ( j = 0; j < STRING_SIZE; j++ ) {
-		 char_array[i][j] = getRandomChar();
-	}
+					// each thread generates its own slice
+  for ( i = 0; i < NUM_THREADS; i++ ) {
+	pthread_create(&threads[i], NULL, fill_slice, (void *) i);
+  }
+  for ( i = 0; i < NUM_THREADS; i++ ) {
+	pthread_join(threads[i], NULL);
   }
 
   for ( i = 0; i < ALPHABET_SIZE; i++ ) {
@@ -47,32 +75,55 @@ void init_arrays()
 void *count_array(void *myID)
 {
   char theChar;
-  int i, j, charLoc;
-  int local_char_count[ALPHABET_SIZE];
+  int i, j, k, step, charLoc;
+  int id = (int) (long) myID;
+  int lane_count[LANES][ALPHABET_SIZE];		// neighbouring chars go to different lanes
+  int *my_count = thread_counts[id].counts;
 
   int startPos = ((int) myID) * (ARRAY_SIZE / NUM_THREADS);
   int endPos = startPos + (ARRAY_SIZE / NUM_THREADS);
 
   printf("myID = %d startPos = %d endPos = %d \n", (int) myID, startPos, endPos);
 
-					// init local count array
-  for ( i = 0; i < ALPHABET_SIZE; i++ ) {
-  	local_char_count[i] = 0;
+					// init local count arrays
+  for ( k = 0; k < LANES; k++ ) {
+	for ( i = 0; i < ALPHABET_SIZE; i++ ) {
+		lane_count[k][i] = 0;
+	}
   }
-					// count up our section of the global array
+					// count up our section of the global array;
+					// a run of equal chars no longer waits on
+					// one counter's previous store
   for ( i = startPos; i < endPos; i++) {
 	for ( j = 0; j < STRING_SIZE; j++ ) {
 	         theChar = char_array[i][j];
 		 charLoc = ((int) theChar) - 97;
-		 local_char_count[charLoc]++;
+		 lane_count[j % LANES][charLoc]++;
 	}
   }
-					// sum up the partial counts into the global arrays
-  pthread_mutex_lock (&mutexsum);
+					// fold the lanes into our padded table
   for ( i = 0; i < ALPHABET_SIZE; i++ ) {
-     char_counts[i] += local_char_count[i];
+	my_count[i] = 0;
+	for ( k = 0; k < LANES; k++ ) {
+		my_count[i] += lane_count[k][i];
+	}
+  }
+					// tree merge instead of a lock: each round,
+					// thread id takes in thread id + step, so
+					// thread 0 ends with the total
+  for ( step = 1; step < NUM_THREADS; step *= 2 ) {
+	pthread_barrier_wait(&merge_barrier);
+	if ( id % (2 * step) == 0 && id + step < NUM_THREADS ) {
+		for ( i = 0; i < ALPHABET_SIZE; i++ ) {
+			my_count[i] += thread_counts[id + step].counts[i];
+		}
+	}
+  }
+  if ( id == 0 ) {
+	for ( i = 0; i < ALPHABET_SIZE; i++ ) {
+		char_counts[i] = my_count[i];
+	}
   }
-  pthread_mutex_unlock (&mutexsum);
 
   pthread_exit(NULL);
 }
@@ -122,7 +173,7 @@ main() {
 
 	print_results();
 
-	pthread_mutex_destroy(&mutexsum);
+	pthread_barrier_destroy(&merge_barrier);
 	printf("Main: program completed. Exiting.\n");
 	pthread_exit(NULL);
 }
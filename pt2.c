@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "splitmix64.h"
+
 //#define NUM_THREADS 4
 int NUM_THREADS;
 
@@ -10,59 +12,84 @@ int NUM_THREADS;
 #define STRING_SIZE 16
 #define ALPHABET_SIZE 26
 
-char char_array[ARRAY_SIZE][STRING_SIZE];
+					// how the rows reach the ranks:
+					//   bcast    rank 0 makes all rows and sends
+					//            every rank all of them
+					//   scatter  rank 0 makes all rows and sends
+					//            each rank its own slice
+					//   local    each rank makes its own slice
+					//            (default; no data is sent)
+enum { MODE_BCAST, MODE_SCATTER, MODE_LOCAL };
+const char *mode_names[] = { "bcast", "scatter", "local" };
+
+char (*char_array)[STRING_SIZE];		// the rows this rank holds
+long first_row, num_rows;			// this rank's slice of the rows
 int char_counts[ALPHABET_SIZE];			// global count of individual characters
 int local_char_count[ALPHABET_SIZE];
 
-char getRandomChar()
+					// make rows [first, last) into rows[0..]
+void fill_rows(char (*rows)[STRING_SIZE], long first, long last)
 {
-	int randNum = 0;
-	char randChar = ' ';
-
-	randNum = ALPHABET_SIZE * (rand() / (RAND_MAX + 1.0)); 	// pick number 0 < # < 25
-	randNum = randNum + 97;				// scale to 'a'
-	randChar = (char) randNum;
-
-	// printf("%c", randChar);
-	return randChar;
+  long i;
+  int j, k;
+  unsigned long long draw[DRAWS_PER_ROW];
+
+  for ( i = first; i < last; i++ ) {
+					// independent draws, then a branch-free
+					// scale to 'a'..'z'; gcc -O3 vectorizes
+					// the row loop (-O2 does not)
+	for ( k = 0; k < DRAWS_PER_ROW; k++ ) {
+		draw[k] = mix64(RNG_SEED + RNG_GAMMA * (unsigned long long) (i * DRAWS_PER_ROW + k));
+	}
+	for ( j = 0; j < STRING_SIZE; j++ ) {
+		unsigned bits = (unsigned) (draw[j / 4] >> (16 * (j % 4))) & 0xffff;
+		rows[i - first][j] = (char) (97 + ((bits * ALPHABET_SIZE) >> 16));
+	}
+  }
 }
 
-void init_arrays()
+void init_arrays(char (*rows)[STRING_SIZE], long first, long last)
 {
-  int i, j; 
+  int i;
 
   printf("Initializing arrays.\n"); fflush(stdout);
 
-  for ( i = 0; i < ARRAY_SIZE; i++) {
-	for ( j = 0; j < STRING_SIZE; j++ ) {
-		 char_array[i][j] = getRandomChar();
-	}
-  }
+  fill_rows(rows, first, last);
 
   for ( i = 0; i < ALPHABET_SIZE; i++ ) {
   	char_counts[i] = 0;
   }
 }
 
+					// rows [first, last) of the whole array
+					// belong to rank myID; the slices differ
+					// by at most one row and cover every row
+long slice_start(int myID)
+{
+  return (long) ARRAY_SIZE * myID / NUM_THREADS;
+}
+
 void *count_array(void *rank)
 {
   char theChar;
-  int i, j, charLoc;
+  long i;
+  int j, charLoc;
   int myID =  *((int*) rank);
 
-  int startPos = ((long) myID) * (ARRAY_SIZE / NUM_THREADS);
-  int endPos = startPos + (ARRAY_SIZE / NUM_THREADS);
+  long startPos = slice_start(myID);
+  long endPos = slice_start(myID + 1);
+  long base = startPos - first_row;		// where our rows sit in char_array
 
-  printf("myID = %d startPos = %d endPos = %d \n", myID, startPos, endPos); fflush(stdout);
+  printf("myID = %d startPos = %ld endPos = %ld \n", myID, startPos, endPos); fflush(stdout);
 
 					// init local count array
   for ( i = 0; i < ALPHABET_SIZE; i++ ) {
   	local_char_count[i] = 0;
   }
 					// count up our section of the global array
-  for ( i = startPos; i < endPos; i++) {
+  for ( i = 0; i < endPos - startPos; i++) {
 	for ( j = 0; j < STRING_SIZE; j++ ) {
-	         theChar = char_array[i][j];
+	         theChar = char_array[base + i][j];
 		 charLoc = ((int) theChar) - 97;
 		 local_char_count[charLoc]++;
 	}
@@ -85,6 +112,8 @@ main(int argc, char* argv[])
 {
 	int i, rc;
 	int numtasks, rank;
+	int mode = MODE_LOCAL;
+	int *send_counts = NULL, *displs = NULL;
 	MPI_Status Status;
 
 
@@ -101,11 +130,59 @@ main(int argc, char* argv[])
 	printf("size = %d rank = %d\n", numtasks, rank);
 	fflush(stdout);
 
+	if ( argc > 1 ) {
+		for ( mode = 0; mode < 3 && strcmp(argv[1], mode_names[mode]) != 0; mode++ )
+			;
+		if ( mode == 3 ) {
+			if ( rank == 0 ) {
+				printf("Usage: %s [bcast|scatter|local]\n", argv[0]);
+			}
+			MPI_Finalize();
+			return 1;
+		}
+	}
+
+					// only bcast keeps every row on every rank
+	first_row = (mode == MODE_BCAST) ? 0 : slice_start(rank);
+	num_rows = (mode == MODE_BCAST) ? ARRAY_SIZE : slice_start(rank + 1) - first_row;
+	if ( rank == 0 && mode == MODE_SCATTER ) {
+		num_rows = ARRAY_SIZE;			// the root makes them all first
+	}
+	char_array = malloc((num_rows > 0 ? num_rows : 1) * STRING_SIZE);
+	if ( char_array == NULL ) {
+		printf("Rank %d could not allocate %ld rows\n", rank, num_rows);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
 	if ( rank == 0 ) {
-		init_arrays();
+		printf("Distribution: %s, %ld bytes of rows on rank 0\n", mode_names[mode],
+		       num_rows * STRING_SIZE);
+		fflush(stdout);
 	}
-	MPI_Bcast(char_array, ARRAY_SIZE * STRING_SIZE, MPI_CHAR, 0, MPI_COMM_WORLD);
-		
+
+	if ( mode == MODE_LOCAL ) {
+		init_arrays(char_array, first_row, first_row + num_rows);
+	} else if ( mode == MODE_BCAST ) {
+		if ( rank == 0 ) {
+			init_arrays(char_array, 0, ARRAY_SIZE);
+		}
+		MPI_Bcast(char_array, ARRAY_SIZE * STRING_SIZE, MPI_CHAR, 0, MPI_COMM_WORLD);
+	} else {
+		if ( rank == 0 ) {
+			init_arrays(char_array, 0, ARRAY_SIZE);
+			send_counts = malloc(numtasks * sizeof(int));
+			displs = malloc(numtasks * sizeof(int));
+			for ( i = 0; i < numtasks; i++ ) {
+				displs[i] = (int) (slice_start(i) * STRING_SIZE);
+				send_counts[i] = (int) ((slice_start(i + 1) - slice_start(i)) * STRING_SIZE);
+			}
+		}
+					// the root's own slice is already in place
+		MPI_Scatterv(char_array, send_counts, displs, MPI_CHAR,
+			     rank == 0 ? MPI_IN_PLACE : (void *) char_array,
+			     (int) ((slice_start(rank + 1) - slice_start(rank)) * STRING_SIZE), MPI_CHAR,
+			     0, MPI_COMM_WORLD);
+	}
+
 	count_array(&rank);
 
 	MPI_Reduce(local_char_count, char_counts, ALPHABET_SIZE, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -115,6 +192,9 @@ main(int argc, char* argv[])
 		print_results();
 	}
 
+	free(char_array);
+	free(send_counts);
+	free(displs);
 	MPI_Finalize();
 	return 0;
 }
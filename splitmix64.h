@@ -0,0 +1,23 @@
+#ifndef SPLITMIX64_H
+#define SPLITMIX64_H
+
+					// Seeded letters shared by pt1.c, pt2.c
+					// and hw4-pt0_chunky.c; DRAWS_PER_ROW
+					// uses the includer's STRING_SIZE
+#define RNG_SEED 0x2545f4914f6cdd1dULL	// fixed: the letters are the same every run
+#define RNG_GAMMA 0x9e3779b97f4a7c15ULL
+#define DRAWS_PER_ROW (STRING_SIZE / 4)	// 16 random bits per letter
+
+					// SplitMix64 output function. Draw n is
+					// mix64(RNG_SEED + n * RNG_GAMMA), so it
+					// depends only on n: any thread (or rank)
+					// can make any rows, in any order, and
+					// get the same letters
+static inline unsigned long long mix64(unsigned long long z)
+{
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+#endif
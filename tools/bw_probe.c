@@ -0,0 +1,298 @@
+#define _GNU_SOURCE  // O_DIRECT is not needed; posix_fadvise and CPU_SET are
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// STREAM-like bandwidth probe: the ceilings the max-ASCII runs are measured
+// against in analyze_results.py.
+//
+// Memory: each thread first-touches its own slice of three large arrays,
+// then the kernels below run over all slices at once, and the best of
+// several repetitions is kept (as STREAM does):
+//   read   sum of a[]               (the access pattern of the kernel)
+//   copy   c[] = a[]
+//   triad  a[] = b[] + s * c[]
+// Bytes moved are counted the STREAM way (no write-allocate traffic).
+//
+// Storage: the input file is read sequentially in large chunks, once after
+// asking the kernel to drop its cached pages ("cold", close to device
+// speed) and once straight after ("warm", page cache speed).
+
+#define DEFAULT_ARRAY_MB 1024
+#define REPS 5
+#define READ_CHUNK (8u << 20)
+
+typedef enum { K_READ, K_COPY, K_TRIAD, K_COUNT } Kernel;
+static const char *const kernel_names[K_COUNT] = {"read", "copy", "triad"};
+static const int kernel_arrays[K_COUNT] = {1, 2, 3};  // Arrays touched per element
+
+typedef struct {
+    double *a, *b, *c;
+    size_t n;                  // Elements per array
+    int num_threads;
+    pthread_barrier_t start, done;
+    Kernel kernel;
+    int quit;
+    uint64_t sums[256];        // One per thread, keeps reads alive
+} Shared;
+
+typedef struct {
+    Shared *shared;
+    int id;
+} Worker;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *worker(void *arg) {
+    Worker *w = (Worker *)arg;
+    Shared *s = w->shared;
+    size_t lo = s->n * w->id / s->num_threads;
+    size_t hi = s->n * (w->id + 1) / s->num_threads;
+
+    // First touch from the thread that will use the slice, so pages land
+    // on its NUMA node
+    for (size_t i = lo; i < hi; i++) {
+        s->a[i] = 1.0;
+        s->b[i] = 2.0;
+        s->c[i] = 0.0;
+    }
+
+    for (;;) {
+        pthread_barrier_wait(&s->start);
+        if (s->quit) {
+            break;
+        }
+        double *a = s->a, *b = s->b, *c = s->c;
+        switch (s->kernel) {
+        case K_READ: {
+            // Integer adds vectorise without -ffast-math, so the loop is
+            // limited by memory rather than by a floating-point add chain
+            const uint64_t *words = (const uint64_t *)a;
+            uint64_t sum = 0;
+            for (size_t i = lo; i < hi; i++) {
+                sum += words[i];
+            }
+            s->sums[w->id] += sum;
+            break;
+        }
+        case K_COPY:
+            memcpy(c + lo, a + lo, (hi - lo) * sizeof(double));
+            break;
+        case K_TRIAD:
+            for (size_t i = lo; i < hi; i++) {
+                a[i] = b[i] + 3.0 * c[i];
+            }
+            break;
+        default:
+            break;
+        }
+        pthread_barrier_wait(&s->done);
+    }
+    return NULL;
+}
+
+// Best GB/s of each memory kernel with num_threads threads
+static int probe_memory(size_t bytes_per_array, int num_threads, double gbs[K_COUNT]) {
+    Shared s;
+    memset(&s, 0, sizeof(s));
+    s.n = bytes_per_array / sizeof(double);
+    s.num_threads = num_threads;
+    s.a = malloc(s.n * sizeof(double));
+    s.b = malloc(s.n * sizeof(double));
+    s.c = malloc(s.n * sizeof(double));
+    if (!s.a || !s.b || !s.c) {
+        perror("Array allocation failed");
+        free(s.a);
+        free(s.b);
+        free(s.c);
+        return -1;
+    }
+    pthread_barrier_init(&s.start, NULL, num_threads + 1);
+    pthread_barrier_init(&s.done, NULL, num_threads + 1);
+
+    pthread_t threads[256];
+    Worker workers[256];
+    for (int i = 0; i < num_threads; i++) {
+        workers[i].shared = &s;
+        workers[i].id = i;
+        pthread_create(&threads[i], NULL, worker, &workers[i]);
+    }
+
+    for (int k = 0; k < K_COUNT; k++) {
+        double best = 0;
+        s.kernel = (Kernel)k;
+        for (int r = 0; r < REPS; r++) {
+            double t0 = now();
+            pthread_barrier_wait(&s.start);
+            pthread_barrier_wait(&s.done);
+            double elapsed = now() - t0;
+            double rate = (double)kernel_arrays[k] * s.n * sizeof(double) / elapsed / 1e9;
+            if (rate > best) {
+                best = rate;
+            }
+        }
+        gbs[k] = best;
+    }
+
+    s.quit = 1;
+    pthread_barrier_wait(&s.start);
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&s.start);
+    pthread_barrier_destroy(&s.done);
+    free(s.a);
+    free(s.b);
+    free(s.c);
+    return 0;
+}
+
+// Sequential read of path in READ_CHUNK pieces; returns GB/s, or -1
+static double read_file_gbs(const char *path, int drop_cache, uint64_t *bytes_out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening file");
+        return -1;
+    }
+    if (drop_cache) {
+        // Only clean, unmapped pages are dropped; without root this is a
+        // best effort, so "cold" can still be partly cached
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    char *buf = malloc(READ_CHUNK);
+    if (!buf) {
+        perror("Read buffer allocation failed");
+        close(fd);
+        return -1;
+    }
+    uint64_t total = 0;
+    double t0 = now();
+    for (;;) {
+        ssize_t got = read(fd, buf, READ_CHUNK);
+        if (got < 0) {
+            perror("Error reading file");
+            free(buf);
+            close(fd);
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        total += (uint64_t)got;
+    }
+    double elapsed = now() - t0;
+    free(buf);
+    close(fd);
+    *bytes_out = total;
+    return elapsed > 0 ? total / elapsed / 1e9 : 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t n,n,...] [-m array_mb] [-f file] [-j out.json]\n", prog);
+    fprintf(stderr, "  -t  thread counts to probe (default: 1 and the online CPU count)\n");
+    fprintf(stderr, "  -m  MB per array, well above the last-level cache (default %d)\n", DEFAULT_ARRAY_MB);
+    fprintf(stderr, "  -f  also measure cold and warm sequential read bandwidth of this file\n");
+    fprintf(stderr, "  -j  write the results as JSON here (default stdout)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int counts[64];
+    int num_counts = 0;
+    size_t array_mb = DEFAULT_ARRAY_MB;
+    const char *file = NULL;
+    const char *json_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:m:f:j:")) != -1) {
+        switch (opt) {
+        case 't':
+            for (char *tok = strtok(optarg, ","); tok && num_counts < 64; tok = strtok(NULL, ",")) {
+                int n = atoi(tok);
+                if (n < 1 || n > 256) {
+                    fprintf(stderr, "Thread counts must be 1-256\n");
+                    return 1;
+                }
+                counts[num_counts++] = n;
+            }
+            break;
+        case 'm':
+            array_mb = strtoull(optarg, NULL, 10);
+            break;
+        case 'f':
+            file = optarg;
+            break;
+        case 'j':
+            json_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (num_counts == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        counts[num_counts++] = 1;
+        if (cpus > 1) {
+            counts[num_counts++] = cpus > 256 ? 256 : (int)cpus;
+        }
+    }
+
+    FILE *out = json_path ? fopen(json_path, "w") : stdout;
+    if (!out) {
+        perror("Error opening JSON output");
+        return 1;
+    }
+
+    fprintf(out, "{\"array_bytes\": %zu, \"memory\": [", array_mb << 20);
+    double peak_read = 0;
+    for (int i = 0; i < num_counts; i++) {
+        double gbs[K_COUNT];
+        if (probe_memory(array_mb << 20, counts[i], gbs) != 0) {
+            return 1;
+        }
+        if (gbs[K_READ] > peak_read) {
+            peak_read = gbs[K_READ];
+        }
+        fprintf(out, "%s{\"threads\": %d", i ? ", " : "", counts[i]);
+        for (int k = 0; k < K_COUNT; k++) {
+            fprintf(out, ", \"%s_gbs\": %.3f", kernel_names[k], gbs[k]);
+        }
+        fputc('}', out);
+        fprintf(stderr, "memory %3d threads: read %.2f, copy %.2f, triad %.2f GB/s\n",
+                counts[i], gbs[K_READ], gbs[K_COPY], gbs[K_TRIAD]);
+    }
+    fprintf(out, "], \"peak_memory_read_gbs\": %.3f", peak_read);
+
+    if (file) {
+        uint64_t bytes = 0;
+        double cold = read_file_gbs(file, 1, &bytes);
+        double warm = read_file_gbs(file, 0, &bytes);
+        if (cold < 0 || warm < 0) {
+            return 1;
+        }
+        fprintf(out, ", \"file\": \"%s\", \"file_bytes\": %llu, \"storage_read_gbs\": %.3f, "
+                "\"page_cache_read_gbs\": %.3f", file, (unsigned long long)bytes, cold, warm);
+        fprintf(stderr, "file: cold %.2f GB/s, warm %.2f GB/s (%llu bytes)\n",
+                cold, warm, (unsigned long long)bytes);
+    }
+    fputs("}\n", out);
+
+    if (json_path && fclose(out) != 0) {
+        perror("Error writing JSON output");
+        return 1;
+    }
+    return 0;
+}
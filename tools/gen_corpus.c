@@ -0,0 +1,446 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Seeded synthetic corpus generator for reproducible benchmark inputs.
+//
+// The output is cut into fixed-size blocks that are generated
+// independently, each from its own RNG stream derived from (seed, block),
+// so the file is identical for a given seed whatever the thread count.
+// Blocks hold whole lines: the last line of a block is shortened to end
+// exactly at the block boundary.
+
+#define DEFAULT_BLOCK (16u << 20)
+#define DEFAULT_THREADS 8
+
+typedef enum { LEN_FIXED, LEN_UNIFORM, LEN_ZIPF, LEN_LOGNORMAL } LengthDist;
+typedef enum { BYTES_ASCII, BYTES_LATIN1, BYTES_UTF8 } ByteDist;
+
+typedef struct {
+    uint64_t size;         // Total bytes to write
+    size_t block;          // Bytes per independently generated block
+    LengthDist lengths;
+    size_t mean;           // fixed: the length; lognormal: the mean
+    size_t min_len;        // uniform lower bound
+    size_t max_len;        // Upper bound for every distribution
+    double zipf_s;         // Zipf exponent
+    double sigma;          // Log-normal shape
+    ByteDist bytes;
+    double non_ascii;      // Share of non-ASCII characters (latin1, utf8)
+    uint64_t seed;
+    int threads;
+    int fd;
+    double *zipf_cdf;      // P(length <= k) for k = 1..max_len
+} GenConfig;
+
+typedef struct {
+    const GenConfig *cfg;
+    uint64_t num_blocks;
+    uint64_t next_block;   // Claimed with an atomic add
+    int failed;
+} GenShared;
+
+// ---------------------------------------------------------------------------
+// Random numbers: xoshiro256** seeded through splitmix64
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void rng_seed(Rng *r, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ (stream * 0xd1342543de82ef95ULL);
+    for (int i = 0; i < 4; i++) {
+        r->s[i] = splitmix64(&x);
+    }
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(Rng *r) {
+    uint64_t *s = r->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+// Uniform double in [0, 1)
+static inline double rng_unit(Rng *r) {
+    return (rng_next(r) >> 11) * 0x1.0p-53;
+}
+
+// Uniform integer in [lo, hi]
+static inline uint64_t rng_range(Rng *r, uint64_t lo, uint64_t hi) {
+    return lo + (uint64_t)(rng_unit(r) * (double)(hi - lo + 1));
+}
+
+// Standard normal via Box-Muller
+static double rng_normal(Rng *r) {
+    double u = rng_unit(r);
+    double v = rng_unit(r);
+    return sqrt(-2.0 * log(1.0 - u)) * cos(2.0 * M_PI * v);
+}
+
+// ---------------------------------------------------------------------------
+// Line lengths and line content
+// ---------------------------------------------------------------------------
+
+static size_t draw_length(const GenConfig *cfg, Rng *r) {
+    size_t len;
+    switch (cfg->lengths) {
+    case LEN_UNIFORM:
+        len = rng_range(r, cfg->min_len, cfg->max_len);
+        break;
+    case LEN_ZIPF: {
+        // Inverse CDF by binary search over the precomputed table
+        double u = rng_unit(r);
+        size_t lo = 0, hi = cfg->max_len - 1;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (cfg->zipf_cdf[mid] < u) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        len = lo + 1;
+        break;
+    }
+    case LEN_LOGNORMAL: {
+        // mu chosen so that the distribution's mean is cfg->mean
+        double mu = log((double)cfg->mean) - cfg->sigma * cfg->sigma / 2;
+        double x = exp(mu + cfg->sigma * rng_normal(r));
+        len = (x >= (double)cfg->max_len) ? cfg->max_len : (size_t)x;
+        break;
+    }
+    case LEN_FIXED:
+    default:
+        len = cfg->mean;
+        break;
+    }
+    return len > cfg->max_len ? cfg->max_len : len;
+}
+
+// Printable ASCII (0x20-0x7e, never a newline) from 8 random bits
+static inline char ascii_from(uint64_t bits) {
+    return (char)(0x20 + (((bits & 0xff) * 95) >> 8));
+}
+
+static inline char ascii_char(Rng *r) {
+    return ascii_from(rng_next(r));
+}
+
+// Fill dst[0, len) with one line's characters. Multi-byte UTF-8 sequences
+// are never cut by the end of the line.
+static void fill_line(const GenConfig *cfg, Rng *r, char *dst, size_t len) {
+    size_t i = 0;
+    switch (cfg->bytes) {
+    case BYTES_ASCII:
+        // Eight characters per random draw: this is the bulk of the work
+        while (i < len) {
+            uint64_t bits = rng_next(r);
+            for (int k = 0; k < 8 && i < len; k++, bits >>= 8) {
+                dst[i++] = ascii_from(bits);
+            }
+        }
+        break;
+    case BYTES_LATIN1: {
+        // Two characters per draw: 16 bits pick the kind, 8 pick the byte
+        uint32_t threshold = (uint32_t)(cfg->non_ascii * 65536.0);
+        while (i < len) {
+            uint64_t bits = rng_next(r);
+            for (int k = 0; k < 2 && i < len; k++, bits >>= 32) {
+                if ((bits & 0xffff) < threshold) {
+                    dst[i++] = (char)(0xa0 + (((bits >> 16) & 0xff) * 96 >> 8));
+                } else {
+                    dst[i++] = ascii_from(bits >> 16);
+                }
+            }
+        }
+        break;
+    }
+    case BYTES_UTF8:
+        while (i < len) {
+            // Of the non-ASCII characters, 70% take 2 bytes, 25% 3 and 5% 4
+            uint32_t cp;
+            int n = 1;
+            if (rng_unit(r) < cfg->non_ascii) {
+                double kind = rng_unit(r);
+                if (kind < 0.70) {
+                    n = 2;
+                    cp = (uint32_t)rng_range(r, 0x80, 0x7ff);
+                } else if (kind < 0.95) {
+                    n = 3;
+                    do {
+                        cp = (uint32_t)rng_range(r, 0x800, 0xffff);
+                    } while (cp >= 0xd800 && cp <= 0xdfff);  // No surrogates
+                } else {
+                    n = 4;
+                    cp = (uint32_t)rng_range(r, 0x10000, 0x10ffff);
+                }
+            }
+            if (n == 1 || i + n > len) {
+                dst[i++] = ascii_char(r);
+                continue;
+            }
+            unsigned char *p = (unsigned char *)dst + i;
+            if (n == 2) {
+                p[0] = 0xc0 | (cp >> 6);
+                p[1] = 0x80 | (cp & 0x3f);
+            } else if (n == 3) {
+                p[0] = 0xe0 | (cp >> 12);
+                p[1] = 0x80 | ((cp >> 6) & 0x3f);
+                p[2] = 0x80 | (cp & 0x3f);
+            } else {
+                p[0] = 0xf0 | (cp >> 18);
+                p[1] = 0x80 | ((cp >> 12) & 0x3f);
+                p[2] = 0x80 | ((cp >> 6) & 0x3f);
+                p[3] = 0x80 | (cp & 0x3f);
+            }
+            i += n;
+        }
+        break;
+    }
+}
+
+// Generate block b (len bytes, the last block may be short) into buf
+static void generate_block(const GenConfig *cfg, uint64_t b, char *buf, size_t len) {
+    Rng r;
+    rng_seed(&r, cfg->seed, b);
+    size_t pos = 0;
+    while (pos < len) {
+        size_t line = draw_length(cfg, &r);
+        if (line + 1 > len - pos) {
+            line = len - pos - 1;  // The block ends with this line
+        }
+        fill_line(cfg, &r, buf + pos, line);
+        pos += line;
+        buf[pos++] = '\n';
+    }
+}
+
+static int pwrite_all(int fd, const char *buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+static void *worker(void *arg) {
+    GenShared *shared = (GenShared *)arg;
+    const GenConfig *cfg = shared->cfg;
+    char *buf = malloc(cfg->block);
+    if (!buf) {
+        perror("Block buffer allocation failed");
+        __atomic_store_n(&shared->failed, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    for (;;) {
+        uint64_t b = __atomic_fetch_add(&shared->next_block, 1, __ATOMIC_RELAXED);
+        if (b >= shared->num_blocks || __atomic_load_n(&shared->failed, __ATOMIC_RELAXED)) {
+            break;
+        }
+        uint64_t offset = b * cfg->block;
+        size_t len = (cfg->size - offset < cfg->block) ? (size_t)(cfg->size - offset) : cfg->block;
+        generate_block(cfg, b, buf, len);
+        if (pwrite_all(cfg->fd, buf, len, (off_t)offset) != 0) {
+            perror("Error writing output");
+            __atomic_store_n(&shared->failed, 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Command line
+// ---------------------------------------------------------------------------
+
+// Parse a byte count with an optional K, M, G or T suffix (powers of 1024)
+static int parse_size(const char *text, uint64_t *out) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0) {
+        return -1;
+    }
+    switch (*end) {
+    case 'k': case 'K': value *= 1024.0; end++; break;
+    case 'm': case 'M': value *= 1024.0 * 1024; end++; break;
+    case 'g': case 'G': value *= 1024.0 * 1024 * 1024; end++; break;
+    case 't': case 'T': value *= 1024.0 * 1024 * 1024 * 1024; end++; break;
+    default: break;
+    }
+    if (*end == 'B' || *end == 'b') {
+        end++;
+    }
+    if (*end != '\0') {
+        return -1;
+    }
+    *out = (uint64_t)value;
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s -s size -o file [options]\n", prog);
+    fprintf(stderr, "  -s  total size, e.g. 512M, 20G (K/M/G/T are powers of 1024)\n");
+    fprintf(stderr, "  -o  output file (must be seekable)\n");
+    fprintf(stderr, "  -l  line lengths: fixed, uniform, zipf, lognormal (default lognormal)\n");
+    fprintf(stderr, "  -m  mean line length for fixed/lognormal (default 100)\n");
+    fprintf(stderr, "  -n  minimum line length for uniform (default 0)\n");
+    fprintf(stderr, "  -M  maximum line length (default 100000)\n");
+    fprintf(stderr, "  -z  Zipf exponent (default 1.2)\n");
+    fprintf(stderr, "  -S  log-normal sigma (default 1.0)\n");
+    fprintf(stderr, "  -b  bytes: ascii, latin1, utf8 (default ascii)\n");
+    fprintf(stderr, "  -p  share of non-ASCII characters for latin1/utf8 (default 0.3)\n");
+    fprintf(stderr, "  -r  seed (default 1)\n");
+    fprintf(stderr, "  -t  threads (default %d)\n", DEFAULT_THREADS);
+}
+
+int main(int argc, char *argv[]) {
+    GenConfig cfg = {
+        .lengths = LEN_LOGNORMAL, .mean = 100, .min_len = 0, .max_len = 100000,
+        .zipf_s = 1.2, .sigma = 1.0, .bytes = BYTES_ASCII, .non_ascii = 0.3,
+        .seed = 1, .threads = DEFAULT_THREADS, .fd = -1,
+    };
+    const char *out_path = NULL;
+    int have_size = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:o:l:m:n:M:z:S:b:p:r:t:")) != -1) {
+        int ok = 1;
+        switch (opt) {
+        case 's': ok = parse_size(optarg, &cfg.size) == 0; have_size = 1; break;
+        case 'o': out_path = optarg; break;
+        case 'l':
+            if (strcmp(optarg, "fixed") == 0) cfg.lengths = LEN_FIXED;
+            else if (strcmp(optarg, "uniform") == 0) cfg.lengths = LEN_UNIFORM;
+            else if (strcmp(optarg, "zipf") == 0) cfg.lengths = LEN_ZIPF;
+            else if (strcmp(optarg, "lognormal") == 0) cfg.lengths = LEN_LOGNORMAL;
+            else ok = 0;
+            break;
+        case 'm': cfg.mean = strtoull(optarg, NULL, 10); break;
+        case 'n': cfg.min_len = strtoull(optarg, NULL, 10); break;
+        case 'M': cfg.max_len = strtoull(optarg, NULL, 10); ok = cfg.max_len > 0; break;
+        case 'z': cfg.zipf_s = atof(optarg); ok = cfg.zipf_s > 0; break;
+        case 'S': cfg.sigma = atof(optarg); ok = cfg.sigma >= 0; break;
+        case 'b':
+            if (strcmp(optarg, "ascii") == 0) cfg.bytes = BYTES_ASCII;
+            else if (strcmp(optarg, "latin1") == 0) cfg.bytes = BYTES_LATIN1;
+            else if (strcmp(optarg, "utf8") == 0) cfg.bytes = BYTES_UTF8;
+            else ok = 0;
+            break;
+        case 'p': cfg.non_ascii = atof(optarg); ok = cfg.non_ascii >= 0 && cfg.non_ascii <= 1; break;
+        case 'r': cfg.seed = strtoull(optarg, NULL, 0); break;
+        case 't': cfg.threads = atoi(optarg); ok = cfg.threads > 0; break;
+        default: ok = 0; break;
+        }
+        if (!ok) {
+            if (opt != '?') {
+                fprintf(stderr, "Invalid value for -%c: %s\n", opt, optarg);
+            }
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!have_size || !out_path || cfg.min_len > cfg.max_len) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (cfg.lengths == LEN_LOGNORMAL && cfg.mean == 0) {
+        cfg.mean = 1;
+    }
+
+    // Blocks must be able to hold the longest line several times over,
+    // or block ends would cut most long lines short
+    cfg.block = DEFAULT_BLOCK;
+    while (cfg.block < 4 * (cfg.max_len + 1)) {
+        cfg.block *= 2;
+    }
+
+    if (cfg.lengths == LEN_ZIPF) {
+        cfg.zipf_cdf = malloc(cfg.max_len * sizeof(double));
+        if (!cfg.zipf_cdf) {
+            perror("Zipf table allocation failed");
+            return 1;
+        }
+        double sum = 0;
+        for (size_t k = 1; k <= cfg.max_len; k++) {
+            sum += pow((double)k, -cfg.zipf_s);
+            cfg.zipf_cdf[k - 1] = sum;
+        }
+        for (size_t k = 0; k < cfg.max_len; k++) {
+            cfg.zipf_cdf[k] /= sum;
+        }
+    }
+
+    cfg.fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (cfg.fd < 0) {
+        perror("Error opening output");
+        return 1;
+    }
+    // Size the file up front so blocks can land anywhere in any order
+    if (ftruncate(cfg.fd, (off_t)cfg.size) != 0) {
+        perror("Error sizing output (is it a regular file?)");
+        close(cfg.fd);
+        return 1;
+    }
+
+    GenShared shared = {
+        .cfg = &cfg,
+        .num_blocks = (cfg.size + cfg.block - 1) / cfg.block,
+        .next_block = 0,
+        .failed = 0,
+    };
+    pthread_t *threads = malloc(cfg.threads * sizeof(pthread_t));
+    if (!threads) {
+        perror("Thread allocation failed");
+        close(cfg.fd);
+        return 1;
+    }
+    for (int i = 0; i < cfg.threads; i++) {
+        pthread_create(&threads[i], NULL, worker, &shared);
+    }
+    for (int i = 0; i < cfg.threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(cfg.zipf_cdf);
+
+    if (close(cfg.fd) != 0) {
+        perror("Error closing output");
+        return 1;
+    }
+    return shared.failed ? 1 : 0;
+}
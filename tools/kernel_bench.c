@@ -0,0 +1,382 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ascii_kernel.h"
+
+// Microbenchmark for the per-line max-byte kernel, apart from file I/O and
+// output. Every variant runs over buffers of equal-length lines:
+//
+//   strlen+scan     the original loop: strlen, then a byte-by-byte max
+//   omp-simd        a plain loop vectorised by #pragma omp simd
+//   <kernel>        each compiled-in ascii_kernels[] span kernel
+//   <kernel>/scan   the same kernel's fused newline-search + max
+//   <kernel>/stats  the same kernel's fused pass over every LineStats metric
+//
+// Two working sets per line length: "cache" (fits in L2, so the kernel's
+// own speed) and "dram" (far larger than the LLC, so memory bandwidth).
+// Each measurement is warmed up, then repeated; the report gives the
+// median and spread of ns/line and GB/s (line bytes plus separator).
+
+#define CACHE_BYTES (128u << 10)
+#define DEFAULT_DRAM_BYTES (512u << 20)
+#define MAX_LINES (1u << 26)       // Keeps tiny lines in DRAM mode bounded
+#define MIN_REP_SECONDS 0.005      // Repeat a pass until a rep lasts this long
+#define DEFAULT_REPS 11
+#define WARMUP_REPS 2
+
+static const size_t default_lengths[] = {
+    0, 1, 8, 16, 32, 64, 100, 256, 1024, 4096, 16384, 65536
+};
+
+typedef struct {
+    char *newline_text;   // Lines separated by '\n'
+    char *nul_text;       // The same lines separated by '\0' (for strlen)
+    size_t line_len;
+    size_t num_lines;
+} Corpus;
+
+typedef struct {
+    const char *name;
+    uint64_t (*run)(const Corpus *c, const AsciiKernel *k);
+    const AsciiKernel *kernel;
+} Variant;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ---------------------------------------------------------------------------
+// Variants. Each returns a checksum of the maxima so the work cannot be
+// optimised away and the variants can be checked against each other.
+// ---------------------------------------------------------------------------
+
+static uint64_t run_strlen_scan(const Corpus *c, const AsciiKernel *k) {
+    (void)k;
+    uint64_t sum = 0;
+    const char *p = c->nul_text;
+    for (size_t i = 0; i < c->num_lines; i++) {
+        size_t len = strlen(p);
+        int m = 0;
+        for (size_t j = 0; j < len; j++) {
+            unsigned char ch = (unsigned char)p[j];
+            if (ch > m) {
+                m = ch;
+            }
+        }
+        sum += m;
+        p += len + 1;
+    }
+    return sum;
+}
+
+static int max_omp_simd(const unsigned char *p, size_t len) {
+    unsigned char m = 0;
+    #pragma omp simd reduction(max:m)
+    for (size_t j = 0; j < len; j++) {
+        m = p[j] > m ? p[j] : m;
+    }
+    return m;
+}
+
+static uint64_t run_omp_simd(const Corpus *c, const AsciiKernel *k) {
+    (void)k;
+    uint64_t sum = 0;
+    const unsigned char *p = (const unsigned char *)c->newline_text;
+    for (size_t i = 0; i < c->num_lines; i++) {
+        sum += max_omp_simd(p, c->line_len);
+        p += c->line_len + 1;
+    }
+    return sum;
+}
+
+static uint64_t run_span(const Corpus *c, const AsciiKernel *k) {
+    uint64_t sum = 0;
+    const char *p = c->newline_text;
+    for (size_t i = 0; i < c->num_lines; i++) {
+        sum += k->max_span(p, c->line_len);
+        p += c->line_len + 1;
+    }
+    return sum;
+}
+
+static uint64_t run_scan(const Corpus *c, const AsciiKernel *k) {
+    uint64_t sum = 0;
+    size_t size = c->num_lines * (c->line_len + 1);
+    size_t pos = 0;
+    while (pos < size) {
+        int m;
+        pos += k->scan_line(c->newline_text + pos, size - pos, &m) + 1;
+        sum += m;
+    }
+    return sum;
+}
+
+// Checksums the max only, so it matches the other variants
+static uint64_t run_stats(const Corpus *c, const AsciiKernel *k) {
+    uint64_t sum = 0;
+    const char *p = c->newline_text;
+    for (size_t i = 0; i < c->num_lines; i++) {
+        LineStats stats;
+        k->stats_span(p, c->line_len, &stats);
+        sum += stats.max;
+        p += c->line_len + 1;
+    }
+    return sum;
+}
+
+// ---------------------------------------------------------------------------
+// Measurement
+// ---------------------------------------------------------------------------
+
+// Random line bytes: anything but the two separators
+static void fill_corpus(Corpus *c, size_t line_len, size_t bytes, uint64_t seed) {
+    c->line_len = line_len;
+    c->num_lines = bytes / (line_len + 1);
+    if (c->num_lines == 0) {
+        c->num_lines = 1;
+    }
+    if (c->num_lines > MAX_LINES) {
+        c->num_lines = MAX_LINES;
+    }
+    size_t size = c->num_lines * (line_len + 1);
+    c->newline_text = malloc(size);
+    c->nul_text = malloc(size);
+    if (!c->newline_text || !c->nul_text) {
+        perror("Corpus allocation failed");
+        exit(1);
+    }
+
+    uint64_t x = seed;
+    for (size_t i = 0; i < size; i++) {
+        if (i % (line_len + 1) == line_len) {
+            c->newline_text[i] = '\n';
+            c->nul_text[i] = '\0';
+            continue;
+        }
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        unsigned char b = (unsigned char)(x >> 32);
+        if (b == '\n' || b == '\0') {
+            b = ' ';
+        }
+        c->newline_text[i] = (char)b;
+        c->nul_text[i] = (char)b;
+    }
+}
+
+static void free_corpus(Corpus *c) {
+    free(c->newline_text);
+    free(c->nul_text);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    double median_ns;   // ns per line
+    double min_ns;
+    double stddev_ns;
+    double median_gbs;
+    uint64_t checksum;
+} Measurement;
+
+static Measurement measure(const Variant *v, const Corpus *c, int reps) {
+    Measurement m = {0};
+
+    // Calibrate passes per rep so short buffers are timed over enough work
+    int passes = 1;
+    double t0 = now();
+    m.checksum = v->run(c, v->kernel);
+    double one = now() - t0;
+    if (one < MIN_REP_SECONDS) {
+        passes = (int)(MIN_REP_SECONDS / (one > 1e-9 ? one : 1e-9)) + 1;
+    }
+
+    volatile uint64_t sink = 0;
+    for (int w = 0; w < WARMUP_REPS; w++) {
+        for (int p = 0; p < passes; p++) {
+            sink += v->run(c, v->kernel);
+        }
+    }
+
+    double *ns = malloc(reps * sizeof(double));
+    if (!ns) {
+        perror("Allocation failed");
+        exit(1);
+    }
+    double sum = 0;
+    for (int r = 0; r < reps; r++) {
+        double start = now();
+        for (int p = 0; p < passes; p++) {
+            sink += v->run(c, v->kernel);
+        }
+        double elapsed = now() - start;
+        ns[r] = elapsed * 1e9 / ((double)passes * c->num_lines);
+        sum += ns[r];
+    }
+    (void)sink;
+
+    double mean = sum / reps;
+    double var = 0;
+    for (int r = 0; r < reps; r++) {
+        var += (ns[r] - mean) * (ns[r] - mean);
+    }
+    qsort(ns, reps, sizeof(double), compare_double);
+    m.median_ns = ns[reps / 2];
+    m.min_ns = ns[0];
+    m.stddev_ns = sqrt(var / reps);
+    m.median_gbs = (double)(c->line_len + 1) / m.median_ns;  // bytes/ns == GB/s
+    free(ns);
+    return m;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-l len,len,...] [-v variant,...] [-r reps] [-d dram_mb] [-m cache|dram|both] [-c]\n", prog);
+    fprintf(stderr, "  -l  line lengths in bytes (default 0 to 65536)\n");
+    fprintf(stderr, "  -v  only these variants (default all supported)\n");
+    fprintf(stderr, "  -r  timed repetitions per measurement (default %d)\n", DEFAULT_REPS);
+    fprintf(stderr, "  -d  DRAM working set in MB (default %u)\n", DEFAULT_DRAM_BYTES >> 20);
+    fprintf(stderr, "  -m  working sets to run (default both)\n");
+    fprintf(stderr, "  -c  print CSV instead of a table\n");
+}
+
+static int selected(const char *list, const char *name) {
+    if (!list) {
+        return 1;
+    }
+    size_t n = strlen(name);
+    for (const char *p = list; *p; ) {
+        const char *comma = strchr(p, ',');
+        size_t len = comma ? (size_t)(comma - p) : strlen(p);
+        if (len == n && strncmp(p, name, n) == 0) {
+            return 1;
+        }
+        p += len + (comma ? 1 : 0);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t lengths[64];
+    int num_lengths = 0;
+    const char *only = NULL;
+    int reps = DEFAULT_REPS;
+    size_t dram_bytes = DEFAULT_DRAM_BYTES;
+    int run_cache = 1, run_dram = 1;
+    int csv = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:v:r:d:m:c")) != -1) {
+        switch (opt) {
+        case 'l':
+            for (char *tok = strtok(optarg, ","); tok && num_lengths < 64; tok = strtok(NULL, ",")) {
+                lengths[num_lengths++] = strtoull(tok, NULL, 10);
+            }
+            break;
+        case 'v':
+            only = optarg;
+            break;
+        case 'r':
+            reps = atoi(optarg);
+            break;
+        case 'd':
+            dram_bytes = (size_t)strtoull(optarg, NULL, 10) << 20;
+            break;
+        case 'm':
+            run_cache = strcmp(optarg, "dram") != 0;
+            run_dram = strcmp(optarg, "cache") != 0;
+            break;
+        case 'c':
+            csv = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    if (num_lengths == 0) {
+        num_lengths = sizeof(default_lengths) / sizeof(default_lengths[0]);
+        memcpy(lengths, default_lengths, sizeof(default_lengths));
+    }
+
+    // Collect the variants: the two baselines, then every supported
+    // kernel as a span loop, a fused scan and a statistics pass
+    Variant variants[2 + 3 * 16];
+    char names[3 * 16][32];
+    int num_variants = 0;
+    variants[num_variants++] = (Variant){"strlen+scan", run_strlen_scan, NULL};
+    variants[num_variants++] = (Variant){"omp-simd", run_omp_simd, NULL};
+    for (int i = 0; i < ascii_kernel_count && i < 16; i++) {
+        const AsciiKernel *k = &ascii_kernels[i];
+        if (!k->supported()) {
+            continue;
+        }
+        variants[num_variants++] = (Variant){k->name, run_span, k};
+        snprintf(names[3 * i], sizeof(names[0]), "%s/scan", k->name);
+        variants[num_variants++] = (Variant){names[3 * i], run_scan, k};
+        snprintf(names[3 * i + 1], sizeof(names[0]), "%s/stats", k->name);
+        variants[num_variants++] = (Variant){names[3 * i + 1], run_stats, k};
+    }
+
+    if (csv) {
+        printf("mode,line_len,variant,ns_per_line_median,ns_per_line_min,ns_per_line_stddev,gb_per_s\n");
+    } else {
+        printf("Dispatched kernel: %s, %d reps after %d warmup\n", ascii_kernel_active()->name,
+               reps, WARMUP_REPS);
+        printf("%-6s %8s  %-16s %12s %12s %10s %9s\n", "mode", "line", "variant",
+               "ns/line", "min ns", "stddev", "GB/s");
+    }
+
+    for (int mode = 0; mode < 2; mode++) {
+        if ((mode == 0 && !run_cache) || (mode == 1 && !run_dram)) {
+            continue;
+        }
+        const char *mode_name = mode == 0 ? "cache" : "dram";
+        size_t bytes = mode == 0 ? CACHE_BYTES : dram_bytes;
+
+        for (int l = 0; l < num_lengths; l++) {
+            Corpus corpus;
+            fill_corpus(&corpus, lengths[l], bytes, 0x9e3779b97f4a7c15ULL + lengths[l]);
+
+            uint64_t reference = 0;
+            int have_reference = 0;
+            for (int v = 0; v < num_variants; v++) {
+                if (!selected(only, variants[v].name)) {
+                    continue;
+                }
+                Measurement m = measure(&variants[v], &corpus, reps);
+                if (!have_reference) {
+                    reference = m.checksum;
+                    have_reference = 1;
+                } else if (m.checksum != reference) {
+                    fprintf(stderr, "%s disagrees with the other variants at line length %zu\n",
+                            variants[v].name, lengths[l]);
+                    return 1;
+                }
+                if (csv) {
+                    printf("%s,%zu,%s,%.3f,%.3f,%.3f,%.3f\n", mode_name, lengths[l],
+                           variants[v].name, m.median_ns, m.min_ns, m.stddev_ns, m.median_gbs);
+                } else {
+                    printf("%-6s %8zu  %-16s %12.2f %12.2f %10.2f %9.2f\n", mode_name, lengths[l],
+                           variants[v].name, m.median_ns, m.min_ns, m.stddev_ns, m.median_gbs);
+                }
+                fflush(stdout);
+            }
+            free_corpus(&corpus);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "line_index.h"
+#include "mapped_input.h"
+
+// Build, check or use the "<file>.idx" line-offset index:
+//
+//   line_index [-t threads] file      build (or rebuild) file.idx
+//   line_index -c file                say whether file.idx is current
+//   line_index -n N [-n M...] file    print line N (0-based) without a scan
+//
+// Once built, every backend partitions the file from the index, and
+// `maxascii -r first:count` opens a line range without reading the rest.
+
+#define DEFAULT_THREADS 8
+#define MAX_QUERIES 1024
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t threads] [-c] [-n line]... file\n", prog);
+    fprintf(stderr, "  -t  threads used to build the index (default %d)\n", DEFAULT_THREADS);
+    fprintf(stderr, "  -c  only check whether file.idx matches file\n");
+    fprintf(stderr, "  -n  print line N (0-based) through the index; may repeat\n");
+}
+
+int main(int argc, char *argv[]) {
+    int num_threads = DEFAULT_THREADS;
+    int check = 0;
+    uint64_t queries[MAX_QUERIES];
+    int num_queries = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:cn:")) != -1) {
+        switch (opt) {
+        case 't':
+            num_threads = atoi(optarg);
+            if (num_threads > 0) {
+                break;
+            }
+            fprintf(stderr, "Thread count must be positive\n");
+            usage(argv[0]);
+            return 1;
+        case 'c':
+            check = 1;
+            break;
+        case 'n':
+            if (num_queries < MAX_QUERIES) {
+                queries[num_queries++] = strtoull(optarg, NULL, 10);
+                break;
+            }
+            fprintf(stderr, "At most %d lines per run\n", MAX_QUERIES);
+            return 1;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *filename = argv[optind];
+
+    if (check) {
+        LineIndex index;
+        int rc = line_index_open(&index, filename);
+        if (rc == 0) {
+            printf("%s.idx: current, %llu lines\n", filename, (unsigned long long)index.num_lines);
+            line_index_close(&index);
+        } else if (rc > 0) {
+            printf("%s.idx: missing or stale\n", filename);
+        }
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (num_queries == 0) {
+        if (line_index_build(filename, num_threads) != 0) {
+            return 1;
+        }
+        LineIndex index;
+        if (line_index_open(&index, filename) != 0) {
+            return 1;
+        }
+        fprintf(stderr, "Indexed %llu lines of %s\n", (unsigned long long)index.num_lines, filename);
+        line_index_close(&index);
+        return 0;
+    }
+
+    // Random access: an O(1) lookup in the index, then only that line is read
+    LineIndex index;
+    if (line_index_open(&index, filename) != 0) {
+        fprintf(stderr, "No current index for %s; run %s %s first\n", filename, argv[0], filename);
+        return 1;
+    }
+    MappedInput input;
+    if (mapped_input_map(&input, filename) != 0) {
+        line_index_close(&index);
+        return 1;
+    }
+    int rc = 0;
+    for (int i = 0; i < num_queries; i++) {
+        if (queries[i] >= index.num_lines) {
+            fprintf(stderr, "Line %llu is past the last line (%llu lines)\n",
+                    (unsigned long long)queries[i], (unsigned long long)index.num_lines);
+            rc = 1;
+            continue;
+        }
+        uint64_t begin, end;
+        line_index_line(&index, queries[i], &begin, &end);
+        fwrite(input.data + begin, 1, end - begin, stdout);
+        putchar('\n');
+    }
+    mapped_input_close(&input);
+    line_index_close(&index);
+    return rc;
+}
@@ -0,0 +1,155 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "result_format.h"
+
+// Decode a binary or RLE result file (from -f bin / -f rle) back into the
+// "<line>: <max>" text rows, or just describe it with -H.
+
+#define CHUNK_LINES 65536
+
+typedef struct {
+    FILE *in;
+    uint8_t buf[1 << 16];
+    size_t pos;
+    size_t len;
+} ByteReader;
+
+// Next input byte, or -1 at end of input
+static int next_byte(ByteReader *r) {
+    if (r->pos == r->len) {
+        r->len = fread(r->buf, 1, sizeof(r->buf), r->in);
+        r->pos = 0;
+        if (r->len == 0) {
+            return -1;
+        }
+    }
+    return r->buf[r->pos++];
+}
+
+// Flush count decoded results as text rows
+static void emit(const uint8_t *values, size_t count, uint64_t first_line, char *text) {
+    size_t len = format_results(text, first_line, values, count);
+    fwrite(text, 1, len, stdout);
+}
+
+// Returns the number of lines decoded, or -1 on a malformed stream
+static long long decode(ByteReader *r, OutputFormat format, uint64_t limit) {
+    uint8_t *values = malloc(CHUNK_LINES);
+    char *text = malloc((size_t)CHUNK_LINES * RESULT_ROW_MAX);
+    if (!values || !text) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    uint64_t line = 0;
+    size_t pending = 0;
+    long long result = 0;
+    while (line + pending < limit) {
+        int value = next_byte(r);
+        if (value < 0) {
+            break;
+        }
+        uint64_t run = 1;
+        if (format == OUTPUT_RLE) {
+            run = 0;
+            int shift = 0;
+            int b;
+            do {
+                b = next_byte(r);
+                if (b < 0 || shift > 63) {
+                    fprintf(stderr, "Error: truncated run length after line %llu\n",
+                            (unsigned long long)(line + pending));
+                    result = -1;
+                    goto done;
+                }
+                run |= (uint64_t)(b & 0x7f) << shift;
+                shift += 7;
+            } while (b & 0x80);
+        }
+        while (run > 0) {
+            size_t take = CHUNK_LINES - pending;
+            if (take > run) {
+                take = (size_t)run;
+            }
+            memset(values + pending, value, take);
+            pending += take;
+            run -= take;
+            if (pending == CHUNK_LINES) {
+                emit(values, pending, line, text);
+                line += pending;
+                pending = 0;
+            }
+        }
+    }
+    emit(values, pending, line, text);
+    line += pending;
+    result = (long long)line;
+
+done:
+    free(values);
+    free(text);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    int header_only = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "H")) != -1) {
+        if (opt == 'H') {
+            header_only = 1;
+            continue;
+        }
+        fprintf(stderr, "Usage: %s [-H] [file]\n", argv[0]);
+        fprintf(stderr, "  -H  print the header instead of decoding the rows\n");
+        return 1;
+    }
+
+    FILE *in = stdin;
+    if (optind < argc && strcmp(argv[optind], "-") != 0) {
+        in = fopen(argv[optind], "rb");
+        if (!in) {
+            perror("Error opening file");
+            return 1;
+        }
+    }
+
+    uint8_t header[RESULT_HEADER_SIZE];
+    OutputFormat format;
+    uint64_t num_lines;
+    if (fread(header, 1, RESULT_HEADER_SIZE, in) != RESULT_HEADER_SIZE ||
+        decode_header(header, &format, &num_lines) != 0) {
+        fprintf(stderr, "Error: not a max-ascii result file\n");
+        return 1;
+    }
+
+    if (header_only) {
+        printf("encoding: %s\n", format == OUTPUT_RLE ? "rle" : "binary");
+        if (num_lines == RESULT_COUNT_UNKNOWN) {
+            printf("lines: unknown (decode to end of file)\n");
+        } else {
+            printf("lines: %llu\n", (unsigned long long)num_lines);
+        }
+        return 0;
+    }
+
+    static ByteReader reader;
+    reader.in = in;
+    long long decoded = decode(&reader, format, num_lines);
+    fflush(stdout);
+    if (decoded < 0) {
+        return 1;
+    }
+    if (num_lines != RESULT_COUNT_UNKNOWN && (uint64_t)decoded != num_lines) {
+        fprintf(stderr, "Error: header promises %llu lines but only %lld were present\n",
+                (unsigned long long)num_lines, decoded);
+        return 1;
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "range_max.h"
+#include "result_format.h"
+
+// Answer "max byte across lines a..b" queries over a run's results:
+//
+//   max_query results.bin < queries        build in memory, query stdin
+//   max_query -o results.rmq results.rle   save the structure for later
+//   max_query -q queries.txt results.rmq   map a saved one, no rebuild
+//
+// The input is a result file in any format (text rows, -f bin, -f rle) or
+// a saved .rmq. Each query line holds two 0-based line numbers, first and
+// last (inclusive); each answer is printed as "first last: max".
+
+typedef struct {
+    uint8_t *values;
+    uint64_t count;
+    uint64_t capacity;
+} ValueBuffer;
+
+static int push_values(ValueBuffer *buf, uint8_t value, uint64_t run) {
+    if (buf->count + run > buf->capacity) {
+        uint64_t cap = buf->capacity ? buf->capacity : 1 << 20;
+        while (cap < buf->count + run) {
+            cap *= 2;
+        }
+        uint8_t *grown = realloc(buf->values, cap);
+        if (!grown) {
+            perror("Result buffer allocation failed");
+            return -1;
+        }
+        buf->values = grown;
+        buf->capacity = cap;
+    }
+    memset(buf->values + buf->count, value, run);
+    buf->count += run;
+    return 0;
+}
+
+// Read every per-line max from a text, binary or RLE result file
+static int read_results(FILE *in, ValueBuffer *buf) {
+    uint8_t header[RESULT_HEADER_SIZE];
+    OutputFormat format;
+    uint64_t num_lines;
+    size_t got = fread(header, 1, RESULT_HEADER_SIZE, in);
+    if (got < RESULT_HEADER_SIZE || decode_header(header, &format, &num_lines) != 0) {
+        // Text rows "<line>: <max>", possibly among the progress messages
+        // that share stdout with them
+        rewind(in);
+        char *row = NULL;
+        size_t row_cap = 0;
+        int rc = 0;
+        while (rc == 0 && getline(&row, &row_cap, in) > 0) {
+            unsigned long long line;
+            unsigned value;
+            if (sscanf(row, "%llu: %u", &line, &value) != 2) {
+                continue;
+            }
+            if (line != buf->count) {
+                fprintf(stderr, "Error: expected row %llu, found %llu\n",
+                        (unsigned long long)buf->count, line);
+                rc = -1;
+            } else {
+                rc = push_values(buf, (uint8_t)value, 1);
+            }
+        }
+        free(row);
+        return rc;
+    }
+
+    int c;
+    while (buf->count < num_lines && (c = fgetc(in)) != EOF) {
+        uint64_t run = 1;
+        if (format == OUTPUT_RLE) {
+            run = 0;
+            int shift = 0;
+            int b;
+            do {
+                b = fgetc(in);
+                if (b == EOF || shift > 63) {
+                    fprintf(stderr, "Error: truncated run length\n");
+                    return -1;
+                }
+                run |= (uint64_t)(b & 0x7f) << shift;
+                shift += 7;
+            } while (b & 0x80);
+        }
+        if (push_values(buf, (uint8_t)c, run) != 0) {
+            return -1;
+        }
+    }
+    if (num_lines != RESULT_COUNT_UNKNOWN && buf->count != num_lines) {
+        fprintf(stderr, "Error: header promises %llu lines but %llu were present\n",
+                (unsigned long long)num_lines, (unsigned long long)buf->count);
+        return -1;
+    }
+    return 0;
+}
+
+static int answer(const RangeMax *rmq, FILE *queries) {
+    char line[256];
+    int rc = 0;
+    while (fgets(line, sizeof(line), queries)) {
+        unsigned long long first, last;
+        if (sscanf(line, "%llu %llu", &first, &last) != 2) {
+            continue;  // Blank lines and comments
+        }
+        if (first > last || last >= rmq->num_lines) {
+            fprintf(stderr, "Bad range %llu %llu (%llu lines)\n", first, last,
+                    (unsigned long long)rmq->num_lines);
+            rc = 1;
+            continue;
+        }
+        printf("%llu %llu: %u\n", first, last, range_max_query(rmq, first, last));
+    }
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    const char *query_path = NULL;
+    const char *save_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "q:o:")) != -1) {
+        switch (opt) {
+        case 'q':
+            query_path = optarg;
+            break;
+        case 'o':
+            save_path = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-q queries] [-o saved.rmq] results|saved.rmq\n", argv[0]);
+            fprintf(stderr, "  -q  read \"first last\" queries from this file ('-' or default: stdin)\n");
+            fprintf(stderr, "  -o  save the structure; without -q, exit after saving\n");
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-q queries] [-o saved.rmq] results|saved.rmq\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[optind];
+
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        perror("Error opening results");
+        return 1;
+    }
+    uint8_t head[4];
+    size_t head_len = fread(head, 1, sizeof(head), in);
+
+    RangeMax rmq;
+    if (range_max_is_saved(head, head_len)) {
+        fclose(in);
+        if (range_max_load(&rmq, path) != 0) {
+            return 1;
+        }
+    } else {
+        rewind(in);
+        ValueBuffer buf = {0};
+        int rc = read_results(in, &buf);
+        fclose(in);
+        if (rc != 0 || range_max_build(&rmq, buf.values, buf.count) != 0) {
+            free(buf.values);
+            return 1;
+        }
+        free(buf.values);
+    }
+
+    int rc = 0;
+    if (save_path && range_max_save(&rmq, save_path) != 0) {
+        rc = 1;
+    }
+    if (rc == 0 && (query_path || !save_path)) {
+        FILE *queries = stdin;
+        if (query_path && strcmp(query_path, "-") != 0) {
+            queries = fopen(query_path, "r");
+            if (!queries) {
+                perror("Error opening queries");
+                range_max_free(&rmq);
+                return 1;
+            }
+        }
+        rc = answer(&rmq, queries);
+        if (queries != stdin) {
+            fclose(queries);
+        }
+    }
+    range_max_free(&rmq);
+    return rc;
+}